@@ -10,6 +10,10 @@
 #	define WEAVER_ASSERT(condition) assert(condition)
 #endif
 
+#ifndef WEAVER_SIMD
+#	define WEAVER_SIMD 1
+#endif
+
 #ifndef WEAVER_DECIMAL_TYPE
 #	define WEAVER_DECIMAL_TYPE double
 #endif
@@ -19,6 +23,11 @@
 #	define WEAVER_VOXEL_ID_TYPE uint32_t
 #endif
 
+#ifndef WEAVER_MATERIAL_ID_TYPE
+#	include <cstdint>
+#	define WEAVER_MATERIAL_ID_TYPE uint16_t
+#endif
+
 #ifndef WEAVER_VOXEL_UNSET_ID
 #	include <cstdint>
 #	define WEAVER_VOXEL_UNSET_ID UINT32_MAX
@@ -30,8 +39,11 @@ namespace weaver
 {
 using decimal_t = WEAVER_DECIMAL_TYPE;
 using voxel_id_t = WEAVER_VOXEL_ID_TYPE;
+using material_id_t = WEAVER_MATERIAL_ID_TYPE;
 
 static constexpr voxel_id_t unset_voxel_id{ WEAVER_VOXEL_UNSET_ID };
+/// Material id of faces without a material, the empty name.
+static constexpr material_id_t no_material_id{ 0 };
 } /// namespace weaver
 } // namespace tc
 
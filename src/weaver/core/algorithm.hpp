@@ -5,6 +5,10 @@
 #include "attributes.hpp"
 #include <cstdint>
 
+#if defined _MSC_VER
+#	include <intrin.h>
+#endif
+
 namespace tc
 {
 	namespace weaver
@@ -26,6 +30,19 @@ namespace tc
 			}
 			return v;
 		}
+
+		/// Number of trailing zero bits, value must not be zero.
+		static inline int32_t countr_zero(uint64_t value) WEAVER_NOEXCEPT
+		{
+			WEAVER_ASSERT(value != 0);
+#if defined _MSC_VER
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return static_cast<int32_t>(index);
+#else
+			return __builtin_ctzll(value);
+#endif
+		}
 	}
 }
 
@@ -3,8 +3,10 @@
 
 #include "../config/config.hpp"
 #include "attributes.hpp"
+#include <cstddef>
 #include <cstdint>
 #include <string_view>
+#include <type_traits>
 
 namespace tc
 {
@@ -41,6 +43,29 @@ namespace tc
 		WEAVER_API static constexpr Size fnv1a(std::basic_string_view<Char> str) {
 			return fnv1a<Char, Size>(str.data());
 		}
+
+		/// Continues the hash h with the bytes of data, start with fnv1a_offset.
+		template<typename Size = uint64_t>
+		WEAVER_API static Size fnv1a(const void* data, size_t size, Size h) {
+			auto bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; ++i)
+			{
+				h ^= static_cast<Size>(bytes[i]);
+				h *= internal::fnv<Size>::prime;
+			}
+
+			return h;
+		}
+
+		/// Continues the hash h with the object representation of value.
+		template<typename Value, typename Size = uint64_t>
+		WEAVER_API static Size fnv1a_append(Size h, const Value& value) {
+			static_assert(std::is_trivially_copyable_v<Value>, "value has to be hashed by its bytes");
+			return fnv1a<Size>(&value, sizeof(Value), h);
+		}
+
+		template<typename Size = uint64_t>
+		static constexpr Size fnv1a_offset = internal::fnv<Size>::offset;
 	}
 }
 
@@ -0,0 +1,101 @@
+#ifndef WEAVER_CORE_MATERIAL_REGISTRY_HPP
+#define WEAVER_CORE_MATERIAL_REGISTRY_HPP
+
+#include "../config/config.hpp"
+#include "attributes.hpp"
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tc
+{
+namespace weaver
+{
+/// Interns material names into dense ids, id 0 (no_material_id) is the empty
+/// name. Names keep their address for the lifetime of the registry.
+class WEAVER_API material_registry {
+    public:
+	material_registry()
+	{
+		intern({});
+	}
+
+	material_registry(const material_registry &other) : names_{ other.names_ }
+	{
+		rebuild();
+	}
+
+	material_registry(material_registry &&) = default;
+
+	material_registry &operator=(const material_registry &other)
+	{
+		if (this != &other) {
+			names_ = other.names_;
+			rebuild();
+		}
+		return *this;
+	}
+
+	material_registry &operator=(material_registry &&) = default;
+
+	/// Id of the name, adding it when it's new.
+	material_id_t intern(std::string_view name)
+	{
+		auto it = ids_.find(name);
+		if (it != std::end(ids_)) {
+			return it->second;
+		}
+
+		if (names_.size() > std::numeric_limits<material_id_t>::max()) {
+			throw std::length_error("too many materials for material_id_t");
+		}
+
+		const auto id = static_cast<material_id_t>(names_.size());
+		ids_.emplace(names_.emplace_back(name), id);
+		return id;
+	}
+
+	/// Id of the name or no_material_id when it isn't registered.
+	material_id_t find(std::string_view name) const
+	{
+		auto it = ids_.find(name);
+		return it != std::end(ids_) ? it->second : no_material_id;
+	}
+
+	bool contains(std::string_view name) const
+	{
+		return ids_.count(name) != 0;
+	}
+
+	std::string_view name(material_id_t id) const
+	{
+		WEAVER_ASSERT(id < names_.size());
+		return names_[id];
+	}
+
+	/// Number of ids including no_material_id.
+	size_t size() const
+	{
+		return names_.size();
+	}
+
+    private:
+	void rebuild()
+	{
+		ids_.clear();
+		for (size_t i = 0; i < names_.size(); ++i) {
+			ids_.emplace(names_[i], static_cast<material_id_t>(i));
+		}
+	}
+
+	// a deque never moves its elements, the views in ids_ stay valid
+	std::deque<std::string> names_;
+	std::unordered_map<std::string_view, material_id_t> ids_;
+};
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_CORE_MATERIAL_REGISTRY_HPP
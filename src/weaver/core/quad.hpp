@@ -14,6 +14,9 @@ namespace tc
 {
 	struct WEAVER_API quad : public std::array<vertex, 4>
 	{
+		using normal_t = base_vector3<weaver::decimal_t>;
+		using uv_t = base_vector2<weaver::decimal_t>;
+
 		enum class triangle {
 			first, second
 		};
@@ -54,10 +57,11 @@ namespace tc
 			};
 		}
 
-		vector3d normal{};
-		std::array<vector2d, 4> uv;
+		normal_t normal{};
+		std::array<uv_t, 4> uv;
 		weaver::voxel_id_t type_id{ weaver::unset_voxel_id };
-		std::string_view material_id{};
+		/// See weaver::material_registry.
+		weaver::material_id_t material_id{ weaver::no_material_id };
 	};
 }
 
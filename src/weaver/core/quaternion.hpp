@@ -4,6 +4,7 @@
 #include "../config/config.hpp"
 #include "attributes.hpp"
 #include "fwd.hpp"
+#include <cstddef>
 #include <utility>
 
 namespace tc
@@ -14,7 +15,7 @@ namespace tc
 
 		const data_t& operator[](size_t i) const
 		{
-			WEAVER_ASSERT(i > 3);
+			WEAVER_ASSERT(i < 4);
 			switch (i)
 			{
 				case 0: return x;
@@ -22,6 +23,9 @@ namespace tc
 				case 2: return z;
 				case 3: return w;
 			}
+
+			// cannot happen
+			return x;
 		}
 
 		data_t& operator[](size_t i)
@@ -0,0 +1,207 @@
+#ifndef WEAVER_CORE_THREAD_POOL_HPP
+#define WEAVER_CORE_THREAD_POOL_HPP
+
+#include "../config/config.hpp"
+#include "attributes.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+/// Executors run fn(index, worker) for every index in [0, count) and return
+/// once all calls finished. worker is below workers() and never used by two
+/// calls at the same time, so it can pick per-worker state.
+
+/// Runs everything on the calling thread.
+class WEAVER_API sequential_executor {
+    public:
+	size_t workers() const
+	{
+		return 1;
+	}
+
+	template <typename Fn> void parallel_for(size_t count, Fn &&fn)
+	{
+		for (size_t i = 0; i < count; ++i) {
+			fn(i, size_t{ 0 });
+		}
+	}
+};
+
+/// Work-stealing pool, the calling thread of parallel_for is worker 0.
+/// Every worker owns a contiguous part of the indices and takes from its front,
+/// workers running out steal from the back of the others.
+/// parallel_for calls are serialized and must not be nested.
+class WEAVER_API thread_pool {
+	struct queue {
+		std::mutex lock;
+		size_t first{ 0 };
+		size_t last{ 0 };
+	};
+
+    public:
+	/// threads of 0 uses one worker per hardware thread.
+	explicit thread_pool(size_t threads = 0)
+	{
+		if (threads == 0) {
+			threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		for (size_t i = 0; i < threads; ++i) {
+			queues_.emplace_back(std::make_unique<queue>());
+		}
+
+		for (size_t i = 1; i < threads; ++i) {
+			threads_.emplace_back([this, i] { run(i); });
+		}
+	}
+
+	thread_pool(const thread_pool &) = delete;
+	thread_pool &operator=(const thread_pool &) = delete;
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> guard{ lock_ };
+			stop_ = true;
+		}
+		wake_.notify_all();
+
+		for (auto &&thread : threads_) {
+			thread.join();
+		}
+	}
+
+	size_t workers() const
+	{
+		return queues_.size();
+	}
+
+	/// Rethrows the first exception thrown by fn after all indices were run.
+	template <typename Fn> void parallel_for(size_t count, Fn &&fn)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> batch{ batch_lock_ };
+
+		const auto n = queues_.size();
+		for (size_t i = 0; i < n; ++i) {
+			std::lock_guard<std::mutex> guard{ queues_[i]->lock };
+			queues_[i]->first = count * i / n;
+			queues_[i]->last = count * (i + 1) / n;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard{ lock_ };
+			task_ = [&fn](size_t index, size_t worker) { fn(index, worker); };
+			error_ = nullptr;
+			active_ = threads_.size();
+			++generation_;
+		}
+		wake_.notify_all();
+
+		work(0);
+
+		std::unique_lock<std::mutex> guard{ lock_ };
+		done_.wait(guard, [this] { return active_ == 0; });
+		task_ = nullptr;
+
+		if (error_) {
+			std::rethrow_exception(std::exchange(error_, nullptr));
+		}
+	}
+
+    private:
+	void run(size_t worker)
+	{
+		size_t seen{ 0 };
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> guard{ lock_ };
+				wake_.wait(guard, [this, seen] { return stop_ || generation_ != seen; });
+				if (stop_) {
+					return;
+				}
+				seen = generation_;
+			}
+
+			work(worker);
+
+			std::lock_guard<std::mutex> guard{ lock_ };
+			if (--active_ == 0) {
+				done_.notify_one();
+			}
+		}
+	}
+
+	void work(size_t worker)
+	{
+		size_t index{ 0 };
+		while (pop(worker, index) || steal(worker, index)) {
+			try {
+				task_(index, worker);
+			} catch (...) {
+				std::lock_guard<std::mutex> guard{ lock_ };
+				if (!error_) {
+					error_ = std::current_exception();
+				}
+			}
+		}
+	}
+
+	bool pop(size_t worker, size_t &index)
+	{
+		auto &&q = *queues_[worker];
+		std::lock_guard<std::mutex> guard{ q.lock };
+		if (q.first == q.last) {
+			return false;
+		}
+
+		index = q.first++;
+		return true;
+	}
+
+	bool steal(size_t worker, size_t &index)
+	{
+		const auto n = queues_.size();
+		for (size_t i = 1; i < n; ++i) {
+			auto &&q = *queues_[(worker + i) % n];
+			std::lock_guard<std::mutex> guard{ q.lock };
+			if (q.first != q.last) {
+				index = --q.last;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	std::vector<std::unique_ptr<queue>> queues_;
+	std::vector<std::thread> threads_;
+	std::function<void(size_t, size_t)> task_;
+	std::exception_ptr error_;
+
+	std::mutex batch_lock_;
+	std::mutex lock_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	size_t generation_{ 0 };
+	size_t active_{ 0 };
+	bool stop_{ false };
+};
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_CORE_THREAD_POOL_HPP
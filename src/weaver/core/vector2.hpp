@@ -3,8 +3,11 @@
 
 #include "../config/config.hpp"
 #include "attributes.hpp"
+#include "algorithm.hpp"
 #include "fwd.hpp"
 #include <utility>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
@@ -31,7 +34,7 @@ template <typename Data> struct WEAVER_API base_vector2 {
 
 	constexpr const Data &operator[](size_t i) const
 	{
-		WEAVER_ASSERT(i > 1);
+		WEAVER_ASSERT(i < 2);
 		switch (i) {
 		case 0:
 			return x;
@@ -170,12 +173,10 @@ template <typename Data> struct WEAVER_API base_vector2 {
 		return x * other.x + y * other.y;
 	}
 
-	constexpr base_vector2 cross(const base_vector2 &other) const
+	/// z of the cross product of the vectors extended to 3 dimensions.
+	constexpr Data cross(const base_vector2 &other) const
 	{
-		auto orig = *this;
-		orig.x = (y * other.z) 
-		orig.y = (x * other.z) 
-		return orig;
+		return x * other.y - y * other.x;
 	}
 
 	constexpr double magnitude_sqrd() const
@@ -186,7 +187,7 @@ template <typename Data> struct WEAVER_API base_vector2 {
 	double magnitude() const
 	{
 		auto mag = magnitude_sqrd();
-		return mag > 0.0 ? sqrt(mag) : 0;
+		return mag > 0.0 ? std::sqrt(mag) : 0;
 	}
 
 	base_vector2 &normalize()
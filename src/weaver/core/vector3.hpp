@@ -6,6 +6,8 @@
 #include "algorithm.hpp"
 #include "fwd.hpp"
 #include <utility>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
@@ -35,7 +37,7 @@ template <typename Data> struct WEAVER_API base_vector3 {
 
 	constexpr const Data &operator[](size_t i) const
 	{
-		WEAVER_ASSERT(i > 2);
+		WEAVER_ASSERT(i < 3);
 		switch (i) {
 		case 0:
 			return x;
@@ -201,7 +203,7 @@ template <typename Data> struct WEAVER_API base_vector3 {
 	double magnitude() const
 	{
 		auto mag = magnitude_sqrd();
-		return mag > 0.0 ? sqrt(mag) : 0;
+		return mag > 0.0 ? std::sqrt(mag) : 0;
 	}
 
 	base_vector3 &normalize()
@@ -1,6 +1,7 @@
 #ifndef WEAVER_CORE_VERTEX_HPP
 #define WEAVER_CORE_VERTEX_HPP
 
+#include "../config/config.hpp"
 #include "fwd.hpp"
 #include <utility>
 #include "vector3.hpp"
@@ -9,7 +10,7 @@ namespace tc
 {
 template <typename data_t> using base_vertex = base_vector3<data_t>;
 
-using vertex = base_vertex<double>;
+using vertex = base_vertex<weaver::decimal_t>;
 } // namespace tc
 
 #endif // WEAVER_CORE_VERTEX_HPP
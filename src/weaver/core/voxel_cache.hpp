@@ -0,0 +1,402 @@
+#ifndef WEAVER_CORE_VOXEL_CACHE_HPP
+#define WEAVER_CORE_VOXEL_CACHE_HPP
+
+#include "../config/config.hpp"
+#include "attributes.hpp"
+#include "hash.hpp"
+#include "voxel_loader.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#	define WEAVER_MMAP 1
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#else
+#	define WEAVER_MMAP 0
+#endif
+
+namespace tc
+{
+namespace weaver
+{
+/// Bumped whenever the layout of the cache file changes.
+static constexpr uint32_t voxel_cache_version = 1;
+
+namespace internal
+{
+	static constexpr char voxel_cache_magic[4]{ 'W', 'V', 'X', 'C' };
+
+	/// Read only view of a whole file, memory mapped where the platform allows.
+	class mapped_file {
+	    public:
+		explicit mapped_file(const std::filesystem::path &path)
+		{
+#if WEAVER_MMAP
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return;
+			}
+
+			struct stat info {};
+			if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+				auto addr = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+						   MAP_PRIVATE, fd, 0);
+				if (addr != MAP_FAILED) {
+					data_ = static_cast<const unsigned char *>(addr);
+					size_ = static_cast<size_t>(info.st_size);
+				}
+			}
+			::close(fd);
+#else
+			std::ifstream stream(path, std::ios::binary);
+			if (!stream) {
+				return;
+			}
+
+			buffer_.assign(std::istreambuf_iterator<char>(stream),
+				       std::istreambuf_iterator<char>());
+			data_ = reinterpret_cast<const unsigned char *>(buffer_.data());
+			size_ = buffer_.size();
+#endif
+		}
+
+		mapped_file(const mapped_file &) = delete;
+		mapped_file &operator=(const mapped_file &) = delete;
+
+		~mapped_file()
+		{
+#if WEAVER_MMAP
+			if (data_ != nullptr) {
+				::munmap(const_cast<unsigned char *>(data_), size_);
+			}
+#endif
+		}
+
+		const unsigned char *data() const
+		{
+			return data_;
+		}
+
+		size_t size() const
+		{
+			return size_;
+		}
+
+	    private:
+		const unsigned char *data_{ nullptr };
+		size_t size_{ 0 };
+#if !WEAVER_MMAP
+		std::vector<char> buffer_;
+#endif
+	};
+
+	/// Appends values in their native representation.
+	struct cache_writer {
+		template <typename Value> void put(const Value &value)
+		{
+			static_assert(std::is_trivially_copyable_v<Value>);
+			auto bytes = reinterpret_cast<const char *>(&value);
+			data.insert(std::end(data), bytes, bytes + sizeof(Value));
+		}
+
+		void put(std::string_view str)
+		{
+			put(static_cast<uint32_t>(str.size()));
+			data.insert(std::end(data), std::begin(str), std::end(str));
+		}
+
+		void put(const vector2d &v)
+		{
+			put(v.x);
+			put(v.y);
+		}
+
+		void put(const vector3d &v)
+		{
+			put(v.x);
+			put(v.y);
+			put(v.z);
+		}
+
+		std::vector<char> data;
+	};
+
+	/// Reads what cache_writer wrote, every read fails once the data runs out.
+	struct cache_reader {
+		template <typename Value> bool get(Value &value)
+		{
+			static_assert(std::is_trivially_copyable_v<Value>);
+			if (last - first < static_cast<std::ptrdiff_t>(sizeof(Value))) {
+				return false;
+			}
+
+			std::memcpy(&value, first, sizeof(Value));
+			first += sizeof(Value);
+			return true;
+		}
+
+		bool get(std::string_view &str)
+		{
+			uint32_t size{ 0 };
+			if (!get(size) || last - first < static_cast<std::ptrdiff_t>(size)) {
+				return false;
+			}
+
+			str = std::string_view{ reinterpret_cast<const char *>(first), size };
+			first += size;
+			return true;
+		}
+
+		bool get(vector2d &v)
+		{
+			return get(v.x) && get(v.y);
+		}
+
+		bool get(vector3d &v)
+		{
+			return get(v.x) && get(v.y) && get(v.z);
+		}
+
+		const unsigned char *first{ nullptr };
+		const unsigned char *last{ nullptr };
+	};
+} // namespace internal
+
+/// Fingerprint of the definition files of dir from their names, sizes and
+/// modification times. Editing, adding or removing a file changes it.
+/// File contents are not read, an edit keeping the size of a file within the
+/// modification time granularity of the file system goes unnoticed and the
+/// cache keeps serving the old definitions until the file is touched again.
+static uint64_t voxel_source_hash(const std::string &dir)
+{
+	namespace fs = std::filesystem;
+
+	struct source {
+		std::string name;
+		uintmax_t size;
+		int64_t time;
+	};
+
+	std::vector<source> sources;
+	for (const auto &entry : fs::directory_iterator(dir)) {
+		const auto time = entry.last_write_time().time_since_epoch().count();
+		sources.emplace_back(source{ entry.path().filename().string(), entry.file_size(),
+					     static_cast<int64_t>(time) });
+	}
+	std::sort(std::begin(sources), std::end(sources),
+		  [](auto &&l, auto &&r) { return l.name < r.name; });
+
+	auto h = fnv1a_offset<uint64_t>;
+	for (auto &&s : sources) {
+		h = fnv1a<uint64_t>(s.name.data(), s.name.size() + 1, h);
+		h = fnv1a_append(h, static_cast<uint64_t>(s.size));
+		h = fnv1a_append(h, s.time);
+	}
+
+	return h;
+}
+
+/// Writes the resolved definitions and materials of a load to path, the file
+/// is replaced at once so readers never see a partial cache. The data goes to
+/// a temporary file of a unique name first, so concurrent writers don't
+/// clobber each other. Throws when the cache can't be written.
+static void write_voxel_cache(const std::filesystem::path &path, const voxel_load_result &loaded,
+			      uint64_t source_hash)
+{
+	internal::cache_writer out;
+	out.data.insert(std::end(out.data), std::begin(internal::voxel_cache_magic),
+			std::end(internal::voxel_cache_magic));
+	out.put(voxel_cache_version);
+	out.put(static_cast<uint8_t>(sizeof(voxel_id_t)));
+	out.put(static_cast<uint8_t>(sizeof(material_id_t)));
+	out.put(source_hash);
+
+	// id 0 is the empty name every registry starts with
+	out.put(static_cast<uint32_t>(loaded.materials.size()));
+	for (size_t i = 1; i < loaded.materials.size(); ++i) {
+		out.put(loaded.materials.name(static_cast<material_id_t>(i)));
+	}
+
+	std::vector<std::string_view> names;
+	names.reserve(loaded.definitions.size());
+	for (auto &&pair : loaded.definitions) {
+		names.emplace_back(pair.first);
+	}
+	std::sort(std::begin(names), std::end(names));
+
+	out.put(static_cast<uint32_t>(names.size()));
+	for (auto &&name : names) {
+		auto &&def = loaded.definitions.at(name);
+		out.put(name);
+		out.put(std::string_view{ def.name });
+		out.put(def.type);
+		out.put(static_cast<uint32_t>(def.components.size()));
+		for (auto &&component : def.components) {
+			out.put(component.min);
+			out.put(component.max);
+			out.put(component.translate);
+			out.put(static_cast<uint8_t>(component.faces.size()));
+			for (auto &&[face, face_def] : component.faces) {
+				out.put(static_cast<uint8_t>(face));
+				out.put(face_def.uv_min);
+				out.put(face_def.uv_max);
+				out.put(static_cast<uint8_t>(face_def.cull));
+				out.put(loaded.materials.find(face_def.material));
+			}
+		}
+	}
+
+	auto tmp = path;
+	tmp += ".tmp" + std::to_string(std::random_device{}());
+	try {
+		{
+			std::ofstream stream(tmp, std::ios::binary | std::ios::trunc);
+			stream.write(out.data.data(), static_cast<std::streamsize>(out.data.size()));
+			if (!stream) {
+				throw std::runtime_error("failed to write voxel cache " + tmp.string());
+			}
+		}
+		std::filesystem::rename(tmp, path);
+	} catch (...) {
+		std::error_code ignored;
+		std::filesystem::remove(tmp, ignored);
+		throw;
+	}
+}
+
+/// Reads a cache written by write_voxel_cache. Returns nothing when the file
+/// is missing, damaged, of another version or built from other sources.
+/// The json of the result is empty, definitions are not parsed again.
+static std::optional<voxel_load_result> read_voxel_cache(const std::filesystem::path &path,
+							 uint64_t source_hash)
+{
+	internal::mapped_file file{ path };
+	internal::cache_reader in{ file.data(), file.data() + file.size() };
+
+	char magic[4]{};
+	uint32_t version{ 0 };
+	uint8_t id_size{ 0 };
+	uint8_t material_size{ 0 };
+	uint64_t hash{ 0 };
+	if (!in.get(magic) || std::memcmp(magic, internal::voxel_cache_magic, sizeof(magic)) != 0 ||
+	    !in.get(version) || version != voxel_cache_version || !in.get(id_size) ||
+	    id_size != sizeof(voxel_id_t) || !in.get(material_size) ||
+	    material_size != sizeof(material_id_t) || !in.get(hash) || hash != source_hash) {
+		return std::nullopt;
+	}
+
+	voxel_load_result result;
+
+	uint32_t material_count{ 0 };
+	if (!in.get(material_count)) {
+		return std::nullopt;
+	}
+	for (uint32_t i = 1; i < material_count; ++i) {
+		std::string_view name;
+		if (!in.get(name)) {
+			return std::nullopt;
+		}
+		result.materials.intern(name);
+	}
+
+	uint32_t count{ 0 };
+	if (!in.get(count)) {
+		return std::nullopt;
+	}
+
+	result.definitions.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		std::string_view key;
+		std::string_view def_name;
+		voxel_def def;
+		uint32_t components{ 0 };
+		if (!in.get(key) || !in.get(def_name) || !in.get(def.type) || !in.get(components)) {
+			return std::nullopt;
+		}
+		def.name = def_name;
+
+		def.components.resize(components);
+		for (auto &&component : def.components) {
+			uint8_t faces{ 0 };
+			if (!in.get(component.min) || !in.get(component.max) ||
+			    !in.get(component.translate) || !in.get(faces)) {
+				return std::nullopt;
+			}
+
+			for (uint8_t f = 0; f < faces; ++f) {
+				uint8_t face{ 0 };
+				uint8_t cull{ 0 };
+				material_id_t material{ no_material_id };
+				face_def face_def;
+				if (!in.get(face) || face >= static_cast<uint8_t>(voxel_face::_count) ||
+				    !in.get(face_def.uv_min) || !in.get(face_def.uv_max) ||
+				    !in.get(cull) || !in.get(material) ||
+				    material >= result.materials.size()) {
+					return std::nullopt;
+				}
+
+				face_def.cull = cull != 0;
+				face_def.material = result.materials.name(material);
+				component.faces.emplace(static_cast<voxel_face>(face), std::move(face_def));
+			}
+		}
+
+		auto name = result.names.store(std::string{ key });
+		result.name_lookup.emplace(voxel_type_id(name), name);
+		result.definitions.emplace(name, std::move(def));
+	}
+
+	index_definitions(result);
+	return result;
+}
+
+/// load_voxels going through the cache at cache_path: a cache matching the
+/// files of dir is read, otherwise the definitions are loaded with the
+/// executor and the cache is written. Writing the cache is best effort, a
+/// cache that can't be written leaves the load as it is. The cache must not
+/// be kept in dir.
+template <typename Executor>
+static voxel_load_result load_voxels_cached(const std::string &dir,
+					    const std::filesystem::path &cache_path,
+					    Executor &executor)
+{
+	const auto source_hash = voxel_source_hash(dir);
+	if (auto cached = read_voxel_cache(cache_path, source_hash)) {
+		return std::move(*cached);
+	}
+
+	// the cache has no json to give back either
+	auto loaded = load_voxels(dir, executor, voxel_load_options{ false });
+	try {
+		write_voxel_cache(cache_path, loaded, source_hash);
+	} catch (const std::exception &) {
+		// the next load tries again
+	}
+	return loaded;
+}
+
+inline voxel_load_result load_voxels_cached(const std::string &dir,
+					    const std::filesystem::path &cache_path)
+{
+	thread_pool pool;
+	return load_voxels_cached(dir, cache_path, pool);
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_CORE_VOXEL_CACHE_HPP
@@ -6,16 +6,37 @@
 #include "voxel_face.hpp"
 #include "vector3.hpp"
 #include "voxel_component_def.hpp"
+#include "hash.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace tc
 {
+namespace weaver
+{
+/// Dense index of definitions that haven't been numbered.
+static constexpr uint32_t no_voxel_index{ UINT32_MAX };
+
+/// Type id of a definition name, the 64 bit fnv1a hash of the name
+/// truncated to voxel_id_t.
+inline voxel_id_t voxel_type_id(std::string_view name)
+{
+	return static_cast<voxel_id_t>(
+		fnv1a<uint64_t>(name.data(), name.size(), fnv1a_offset<uint64_t>));
+}
+} // namespace weaver
 
 struct WEAVER_API voxel_def
 {
 	std::vector<voxel_component_def> components;
 	std::string name;
 	weaver::voxel_id_t type;
+	/// Position in the dense table of the load, see voxel_load_result::by_index.
+	/// Indices are only stable within one set of definitions, store type ids
+	/// where voxels have to outlive it.
+	uint32_t index{ weaver::no_voxel_index };
 };
 
 } // namespace tc
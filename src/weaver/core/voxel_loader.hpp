@@ -10,8 +10,16 @@
 #include <streambuf>
 #include <filesystem>
 #include "voxel_def.hpp"
-#include <unordered_set>
+#include "voxel_parser.hpp"
 #include "hash.hpp"
+#include "material_registry.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <vector>
 
 namespace tc
 {
@@ -42,7 +50,7 @@ static void to_json(nlohmann::json &j, const vector2d &v)
 static void from_json(const nlohmann::json &j, vector2d &v)
 {
 	WEAVER_ASSERT(j.is_array());
-	for (auto i = 0; i < j.size() && i < 2; ++i) {
+	for (size_t i = 0; i < j.size() && i < 2; ++i) {
 		j.at(i).get_to(v[i]);
 	}
 }
@@ -55,7 +63,7 @@ static void to_json(nlohmann::json &j, const vector3d &v)
 static void from_json(const nlohmann::json &j, vector3d &v)
 {
 	WEAVER_ASSERT(j.is_array());
-	for (auto i = 0; i < j.size() && i < 3; ++i) {
+	for (size_t i = 0; i < j.size() && i < 3; ++i) {
 		j.at(i).get_to(v[i]);
 	}
 }
@@ -111,7 +119,7 @@ static void from_json(const nlohmann::json &j, voxel_component_def &v)
 
 	if (j.contains("face")) {
 		for (auto &&face : j.at("face").items()) {
-			voxel_face key;
+			voxel_face key{ voxel_face::_count };
 			face.key() >> key;
 			if (key == voxel_face::_count) {
 				continue;
@@ -133,7 +141,7 @@ static void from_json(const nlohmann::json &j, voxel_def &v)
 	if (j.contains("name")) {
 		j.at("name").get_to(v.name);
 	}
-	v.type = weaver::fnv1a(v.name.data());
+	v.type = weaver::voxel_type_id(v.name);
 
 	if (j.contains("components")) {
 		j.at("components").get_to(v.components);
@@ -169,6 +177,9 @@ static nlohmann::json load_json(const std::filesystem::path &path)
 static std::pair<std::string, nlohmann::json> load_voxel_file(const std::filesystem::path &path)
 {
 	auto json = load_json(path);
+	if (!json.is_object()) {
+		internal::throw_not_an_object();
+	}
 
 	if (!json.contains("name")) {
 		json["name"] = path.stem().string();
@@ -178,125 +189,448 @@ static std::pair<std::string, nlohmann::json> load_voxel_file(const std::filesys
 	return std::make_pair(std::move(name), std::move(json));
 }
 
-static std::vector<nlohmann::json *>
-find_hierarchy(std::unordered_map<std::string_view, nlohmann::json> &definitions,
-	       nlohmann::json &entry)
+/// Owns the strings the views of a load result point to. It can only be moved,
+/// which keeps the strings in place.
+class WEAVER_API string_arena {
+    public:
+	string_arena() = default;
+	string_arena(const string_arena &) = delete;
+	string_arena(string_arena &&) = default;
+	string_arena &operator=(const string_arena &) = delete;
+	string_arena &operator=(string_arena &&) = default;
+
+	std::string_view store(std::string str)
+	{
+		return strings_.emplace_back(std::move(str));
+	}
+
+	size_t size() const
+	{
+		return strings_.size();
+	}
+
+    private:
+	std::deque<std::string> strings_;
+};
+
+struct voxel_load_result {
+	std::unordered_map<std::string_view, nlohmann::json> json;
+	std::unordered_map<std::string_view, tc::voxel_def> definitions;
+	std::unordered_map<voxel_id_t, std::string_view> name_lookup;
+	/// Every face material of the definitions.
+	material_registry materials;
+	/// Names the maps above are keyed by.
+	string_arena names;
+	/// Definitions by voxel_def::index, for readers looking definitions up
+	/// without hashing.
+	std::vector<const voxel_def *> by_index;
+};
+
+/// Thrown when two definition names hash to the same type id, or a name
+/// hashes to unset_voxel_id, in which case second is empty.
+class WEAVER_API voxel_id_collision : public std::runtime_error {
+    public:
+	voxel_id_collision(voxel_id_t id, std::string first, std::string second)
+		: std::runtime_error{ "voxel type id " + std::to_string(id) + " of " + first +
+				      (second.empty() ? " is reserved" : " collides with " + second) },
+		  id{ id }, first{ std::move(first) }, second{ std::move(second) }
+	{
+	}
+
+	voxel_id_t id;
+	std::string first;
+	std::string second;
+};
+
+namespace internal
 {
-	nlohmann::json *current = &entry;
-	std::vector<nlohmann::json *> results;
-	while (current != nullptr) {
-		results.emplace_back(current);
-
-		auto &&parent_key = (*current)["$parent"];
-		if (parent_key.is_null()) {
-			return results;
+	/// Throws voxel_id_collision for the first type id given to two names.
+	static void check_type_ids(std::vector<std::pair<voxel_id_t, std::string_view>> ids)
+	{
+		std::sort(std::begin(ids), std::end(ids));
+		for (size_t i = 0; i < ids.size(); ++i) {
+			if (ids[i].first == unset_voxel_id) {
+				throw voxel_id_collision{ ids[i].first, std::string(ids[i].second), {} };
+			}
+
+			if (i > 0 && ids[i - 1].first == ids[i].first) {
+				throw voxel_id_collision{ ids[i].first, std::string(ids[i - 1].second),
+							  std::string(ids[i].second) };
+			}
 		}
+	}
+} // namespace internal
+
+/// Numbers the definitions in the order of their names, which keeps the
+/// indices independent of the directory and hash order, and fills by_index.
+/// Adding or removing a definition renumbers every name after it, indices
+/// are not stable across definition sets, voxel_reloader keeps them stable
+/// while it runs.
+/// Throws voxel_id_collision when two definitions share a type id.
+static void index_definitions(voxel_load_result &result)
+{
+	std::vector<std::pair<std::string_view, voxel_def *>> defs;
+	std::vector<std::pair<voxel_id_t, std::string_view>> ids;
+	defs.reserve(result.definitions.size());
+	ids.reserve(result.definitions.size());
+	for (auto &&pair : result.definitions) {
+		defs.emplace_back(pair.first, &pair.second);
+		ids.emplace_back(pair.second.type, pair.first);
+	}
+	internal::check_type_ids(std::move(ids));
+
+	std::sort(std::begin(defs), std::end(defs),
+		  [](auto &&l, auto &&r) { return l.first < r.first; });
 
-		current = &(definitions[parent_key.get<std::string>()]);
+	result.by_index.resize(defs.size());
+	for (size_t i = 0; i < defs.size(); ++i) {
+		defs[i].second->index = static_cast<uint32_t>(i);
+		result.by_index[i] = defs[i].second;
 	}
+}
 
-	return results;
+/// Interns the face materials of the definitions in the order of their names,
+/// so the ids don't depend on the directory or hash order.
+static void register_materials(const std::unordered_map<std::string_view, voxel_def> &definitions,
+			       material_registry &materials)
+{
+	std::vector<std::string_view> names;
+	names.reserve(definitions.size());
+	for (auto &&pair : definitions) {
+		names.emplace_back(pair.first);
+	}
+	std::sort(std::begin(names), std::end(names));
+
+	for (auto &&name : names) {
+		for (auto &&component : definitions.at(name).components) {
+			for (size_t f = 0; f < static_cast<size_t>(voxel_face::_count); ++f) {
+				auto it = component.faces.find(static_cast<voxel_face>(f));
+				if (it != std::end(component.faces)) {
+					materials.intern(it->second.material);
+				}
+			}
+		}
+	}
 }
 
-static void replace_all(std::string &str, const std::string_view &from, const std::string_view &to)
+/// Replaces the ${key} placeholders of the face materials in filled with the
+/// values of materials, an object of keys and material names. Materials are
+/// substituted in place in one walk over the faces.
+static void apply_materials(nlohmann::json &filled, const nlohmann::json &materials)
 {
-	if (from.empty())
-	{
+	if (!materials.is_object() || materials.empty()) {
 		return;
 	}
-	
-	size_t start_pos = 0;
-	while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-		str.replace(start_pos, from.length(), to);
-		// In case 'to' contains 'from', like replacing 'x' with 'yx'
-		start_pos += to.length();
+
+	std::unordered_map<std::string, const nlohmann::json *> placeholders;
+	placeholders.reserve(materials.size());
+	for (auto &&material : materials.items()) {
+		WEAVER_ASSERT(material.value().is_string());
+		placeholders.emplace("${" + material.key() + "}", &material.value());
+	}
+
+	auto components = filled.find("components");
+	if (components == filled.end()) {
+		return;
+	}
+
+	WEAVER_ASSERT(components->is_array());
+	for (auto &&component : *components) {
+		auto faces = component.find("face");
+		if (faces == component.end() || !faces->is_object()) {
+			continue;
+		}
+
+		for (auto &&face : *faces) {
+			auto material = face.find("material");
+			if (material == face.end() || !material->is_string()) {
+				continue;
+			}
+
+			auto it = placeholders.find(material->get_ref<const std::string &>());
+			if (it != std::end(placeholders)) {
+				*material = *it->second;
+			}
+		}
 	}
 }
 
-struct voxel_load_result {
-	std::unordered_map<std::string_view, nlohmann::json> json;
-	std::unordered_map<std::string_view, tc::voxel_def> definitions;
-	std::unordered_map<voxel_id_t, std::string_view> name_lookup;
+/// apply_materials for a definition read by parse_voxel_source.
+static void apply_materials(voxel_def &def,
+			    const std::vector<std::pair<std::string, std::string>> &materials)
+{
+	if (materials.empty()) {
+		return;
+	}
+
+	std::unordered_map<std::string, const std::string *> placeholders;
+	placeholders.reserve(materials.size());
+	for (auto &&[key, material] : materials) {
+		placeholders.insert_or_assign("${" + key + "}", &material);
+	}
+
+	for (auto &&component : def.components) {
+		for (auto &&pair : component.faces) {
+			auto it = placeholders.find(pair.second.material);
+			if (it != std::end(placeholders)) {
+				pair.second.material = *it->second;
+			}
+		}
+	}
+}
+
+/// Options of load_voxels.
+struct WEAVER_API voxel_load_options {
+	/// Keep the json of every file in voxel_load_result::json. Without it files
+	/// are read straight into definitions and no json document is built.
+	bool keep_json{ true };
 };
 
-static voxel_load_result load_voxels(const std::string &dir)
+namespace internal
 {
-	namespace fs = std::filesystem;
+	static constexpr size_t no_parent = SIZE_MAX;
+
+	/// Index of the parent of every definition or no_parent, parent_of(i) is
+	/// the name of the parent of definition i or empty.
+	template <typename ParentOf>
+	std::vector<size_t> find_parents(const std::vector<std::string_view> &names,
+					 ParentOf &&parent_of)
+	{
+		std::unordered_map<std::string_view, size_t> indices;
+		indices.reserve(names.size());
+		for (size_t i = 0; i < names.size(); ++i) {
+			indices.emplace(names[i], i);
+		}
 
-	static std::unordered_set<std::string> component_names;
+		std::vector<size_t> parents(names.size(), no_parent);
+		for (size_t i = 0; i < names.size(); ++i) {
+			const std::string_view parent_name = parent_of(i);
+			if (parent_name.empty()) {
+				continue;
+			}
 
-	std::unordered_map<std::string_view, nlohmann::json> entries;
-	std::unordered_map<voxel_id_t, std::string_view> name_lookup;
-	for (const auto &entry : fs::directory_iterator(dir)) {
-		auto &&[tmp_name, json] = load_voxel_file(entry.path());
-
-		std::string_view name = *component_names.emplace(tmp_name).first;
-
-		auto it = entries.emplace(name, std::move(json));
-		auto &&pair = it.first;
-		name_lookup.emplace( fnv1a(name), name);
-	}
-
-	static const std::string component_face_path = "/components/${index}/face/${face}/material";
-	static const std::array<std::string, 6> face_names{
-		"north", "south", "east", "west", "top", "bottom",
-	};
-
-	std::unordered_map<std::string_view, voxel_def> voxels;
-	voxels.reserve(entries.size());
-	for (auto &&pair : entries) {
-		auto &&voxel_json = pair.second;
-		auto hierarchy = find_hierarchy(entries, voxel_json);
-		auto filled = *hierarchy.back();
-		for (size_t i = hierarchy.size() - 1; i < hierarchy.size(); --i) {
-			auto &&json = *hierarchy[i];
-
-			auto components = filled["components"];
-			WEAVER_ASSERT(components.is_array());
-			auto begin_it = std::begin(components);
-
-			auto &&materials = json["materials"];
-			for (auto comp_it = begin_it; comp_it != std::end(components); ++comp_it) {
-				auto index = comp_it - begin_it;
-				auto component_path = component_face_path;
-				replace_all(component_path, "${index}", std::to_string(index));
-				for (auto &&face_key : face_names) {
-					auto face_path = component_path;
-
-					if (materials.is_object()) {
-						replace_all(face_path, "${face}", face_key);
-
-						for (auto &&material : materials.items()) {
-							nlohmann::json patch = R"([
-								{ "op": "test" },
-								{ "op": "replace" }
-							])"_json;
-
-							auto &&key = material.key();
-							auto &&val = material.value();
-
-							patch[0]["path"] = face_path;
-							patch[0]["value"] = "${" + key + "}";
-
-							patch[1]["path"] = face_path;
-							patch[1]["value"] = val.get<std::string>();
-
-							filled = filled.patch(patch);
-						}
-					}
+			auto parent = indices.find(parent_name);
+			if (parent == std::end(indices)) {
+				throw std::runtime_error("unknown $parent " + std::string(parent_name) +
+							 " of " + std::string(names[i]));
+			}
+			parents[i] = parent->second;
+		}
+
+		return parents;
+	}
+
+	/// Index of the $parent of every definition or no_parent.
+	static std::vector<size_t>
+	parent_indices(const std::vector<std::string_view> &names,
+		       const std::vector<const nlohmann::json *> &sources)
+	{
+		return find_parents(names, [&sources](size_t i) -> std::string_view {
+			auto it = sources[i]->find("$parent");
+			if (it == sources[i]->end() || it->is_null()) {
+				return {};
+			}
+			return it->template get_ref<const std::string &>();
+		});
+	}
+
+	/// Calls resolve(i) for the selected definitions, all when selected is
+	/// empty, a level of their $parent chains at a time so every parent is
+	/// resolved before its children start from it.
+	template <typename Executor, typename Resolve>
+	void resolve_levels(const std::vector<std::string_view> &names,
+			    const std::vector<size_t> &parents, const std::vector<bool> &selected,
+			    Executor &executor, Resolve &&resolve)
+	{
+		const auto count = names.size();
+
+		// depth in the $parent chain, every chain is walked once
+		std::vector<size_t> depths(count, SIZE_MAX);
+		std::vector<size_t> chain;
+		size_t max_depth{ 0 };
+		for (size_t i = 0; i < count; ++i) {
+			chain.clear();
+			for (auto j = i; depths[j] == SIZE_MAX; j = parents[j]) {
+				if (parents[j] == no_parent) {
+					depths[j] = 0;
+					break;
+				}
+
+				chain.emplace_back(j);
+				if (chain.size() > count) {
+					throw std::runtime_error("$parent cycle at " + std::string(names[i]));
 				}
 			}
+
+			for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+				depths[*it] = depths[parents[*it]] + 1;
+				max_depth = std::max(max_depth, depths[*it]);
+			}
+		}
+
+		std::vector<std::vector<size_t>> levels(count == 0 ? 0 : max_depth + 1);
+		for (size_t i = 0; i < count; ++i) {
+			if (selected.empty() || selected[i]) {
+				levels[depths[i]].emplace_back(i);
+			}
 		}
 
-		voxel_def def = filled;
-		voxels.emplace(pair.first, std::move(def));
+		for (auto &&level : levels) {
+			executor.parallel_for(level.size(),
+					      [&](size_t index, size_t) { resolve(level[index]); });
+		}
 	}
 
-	return voxel_load_result{
-		std::move(entries),
-		std::move(voxels),
-		std::move(name_lookup)
-	};
+	/// Resolves the json of the selected definitions, see resolve_levels.
+	/// resolved points to where the json of each definition goes, the entries
+	/// that aren't selected have to be resolved.
+	template <typename Executor>
+	void resolve_definitions(const std::vector<std::string_view> &names,
+				 const std::vector<const nlohmann::json *> &sources,
+				 const std::vector<size_t> &parents, const std::vector<bool> &selected,
+				 const std::vector<nlohmann::json *> &resolved, Executor &executor)
+	{
+		resolve_levels(names, parents, selected, executor, [&](size_t i) {
+			auto filled = parents[i] == no_parent ? *sources[i] : *resolved[parents[i]];
+
+			auto materials = sources[i]->find("materials");
+			if (materials != sources[i]->end()) {
+				apply_materials(filled, *materials);
+			}
+
+			// the parent's json carries the name of the chain's root
+			filled["name"] = std::string(names[i]);
+			*resolved[i] = std::move(filled);
+		});
+	}
+
+	/// load_voxels reading the files straight into definitions.
+	template <typename Executor>
+	voxel_load_result load_sources(const std::vector<std::filesystem::path> &paths,
+				       Executor &executor)
+	{
+		std::vector<voxel_source> files(paths.size());
+		executor.parallel_for(paths.size(), [&paths, &files](size_t index, size_t) {
+			auto source = parse_voxel_source(load_file(paths[index]));
+			if (!source.name) {
+				source.name = paths[index].stem().string();
+			}
+			files[index] = std::move(source);
+		});
+
+		voxel_load_result result;
+		result.definitions.reserve(files.size());
+
+		std::vector<std::string_view> names;
+		std::vector<voxel_source *> sources;
+		std::vector<voxel_def *> defs;
+		for (auto &&source : files) {
+			if (result.definitions.count(*source.name) != 0) {
+				continue;
+			}
+
+			auto name = result.names.store(std::move(*source.name));
+			auto it = result.definitions.emplace(name, voxel_def{}).first;
+			result.name_lookup.emplace(voxel_type_id(name), name);
+			names.emplace_back(name);
+			sources.emplace_back(&source);
+			defs.emplace_back(&it->second);
+		}
+
+		const auto parents = find_parents(
+			names, [&sources](size_t i) { return std::string_view{ sources[i]->parent }; });
+
+		resolve_levels(names, parents, {}, executor, [&](size_t i) {
+			auto &&def = *defs[i];
+			if (parents[i] == no_parent) {
+				def = std::move(sources[i]->def);
+			} else {
+				def = *defs[parents[i]];
+			}
+
+			apply_materials(def, sources[i]->materials);
+			def.name = std::string(names[i]);
+			def.type = voxel_type_id(def.name);
+		});
+
+		register_materials(result.definitions, result.materials);
+		index_definitions(result);
+		return result;
+	}
+} // namespace internal
+
+/// Loads every definition file of dir with the executor, e.g. a
+/// weaver::thread_pool. Files are parsed concurrently, then definitions are
+/// resolved a level of their $parent chains at a time, so every parent is
+/// resolved once and its children start from the result.
+/// All state lives in the returned result, loads can run concurrently.
+template <typename Executor>
+static voxel_load_result load_voxels(const std::string &dir, Executor &executor,
+				     const voxel_load_options &options = {})
+{
+	namespace fs = std::filesystem;
+
+	std::vector<fs::path> paths;
+	for (const auto &entry : fs::directory_iterator(dir)) {
+		paths.emplace_back(entry.path());
+	}
+
+	if (!options.keep_json) {
+		return internal::load_sources(paths, executor);
+	}
+
+	std::vector<std::pair<std::string, nlohmann::json>> files(paths.size());
+	executor.parallel_for(paths.size(), [&paths, &files](size_t index, size_t) {
+		files[index] = load_voxel_file(paths[index]);
+	});
+
+	voxel_load_result result;
+	result.json.reserve(files.size());
+
+	std::vector<std::string_view> names;
+	std::vector<const nlohmann::json *> sources;
+	for (auto &&[tmp_name, json] : files) {
+		if (result.json.count(tmp_name) != 0) {
+			continue;
+		}
+
+		auto name = result.names.store(std::move(tmp_name));
+		auto it = result.json.emplace(name, std::move(json)).first;
+		result.name_lookup.emplace(voxel_type_id(name), name);
+		names.emplace_back(name);
+		sources.emplace_back(&it->second);
+	}
+	files.clear();
+
+	const auto count = names.size();
+	std::vector<nlohmann::json> resolved(count);
+	std::vector<nlohmann::json *> targets(count);
+	for (size_t i = 0; i < count; ++i) {
+		targets[i] = &resolved[i];
+	}
+
+	internal::resolve_definitions(names, sources, internal::parent_indices(names, sources), {},
+				      targets, executor);
+
+	std::vector<voxel_def> voxels(count);
+	executor.parallel_for(count, [&](size_t i, size_t) { voxels[i] = resolved[i]; });
+
+	result.definitions.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		result.definitions.emplace(names[i], std::move(voxels[i]));
+	}
+
+	register_materials(result.definitions, result.materials);
+	index_definitions(result);
+
+	return result;
+}
+
+/// load_voxels on a pool with one worker per hardware thread.
+inline voxel_load_result load_voxels(const std::string &dir)
+{
+	thread_pool pool;
+	return load_voxels(dir, pool);
 }
 } // namespace weaver
 } // namespace tc
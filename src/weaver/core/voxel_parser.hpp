@@ -0,0 +1,279 @@
+#ifndef WEAVER_CORE_VOXEL_PARSER_HPP
+#define WEAVER_CORE_VOXEL_PARSER_HPP
+
+#include "../config/config.hpp"
+#include "attributes.hpp"
+#include "nlohmann/json.hpp"
+#include "vector2.hpp"
+#include "vector3.hpp"
+#include "voxel_def.hpp"
+#include "voxel_face.hpp"
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+/// A definition file as written, before its $parent chain is resolved.
+struct WEAVER_API voxel_source {
+	std::optional<std::string> name;
+	std::string parent;
+	/// Key and material of every ${key} placeholder the file substitutes.
+	std::vector<std::pair<std::string, std::string>> materials;
+	/// The components of the file, only used when it has no parent.
+	voxel_def def;
+};
+
+namespace internal
+{
+	/// Thrown by both the DOM and the SAX path for a file whose json isn't an object.
+	[[noreturn]] static void throw_not_an_object()
+	{
+		throw std::runtime_error("voxel definition is not a json object");
+	}
+
+	static voxel_face face_from_name(std::string_view name)
+	{
+		if (name == "north") {
+			return voxel_face::back;
+		} else if (name == "south") {
+			return voxel_face::front;
+		} else if (name == "east") {
+			return voxel_face::right;
+		} else if (name == "west") {
+			return voxel_face::left;
+		} else if (name == "top") {
+			return voxel_face::top;
+		} else if (name == "bottom") {
+			return voxel_face::bottom;
+		}
+
+		return voxel_face::_count;
+	}
+
+	/// nlohmann SAX handler filling a voxel_source as the document is read,
+	/// without building a json document. Reads the same keys as from_json,
+	/// everything else is skipped.
+	class voxel_sax {
+		enum class scope
+		{
+			definition,
+			components,
+			component,
+			faces,
+			face,
+			vector,
+			materials,
+			skip,
+		};
+
+		struct frame {
+			scope kind;
+			std::string key{};
+			face_def *face{ nullptr };
+			vector2d *vec2{ nullptr };
+			vector3d *vec3{ nullptr };
+			size_t index{ 0 };
+		};
+
+	    public:
+		using json = nlohmann::json;
+
+		explicit voxel_sax(voxel_source &out) : out_{ out }
+		{
+		}
+
+		bool null()
+		{
+			return !stack_.empty();
+		}
+
+		bool boolean(bool value)
+		{
+			if (stack_.empty()) {
+				return false;
+			}
+
+			auto &&top = stack_.back();
+			if (top.kind == scope::face && top.key == "cull") {
+				top.face->cull = value;
+			}
+			return true;
+		}
+
+		bool number_integer(json::number_integer_t value)
+		{
+			return number(static_cast<double>(value));
+		}
+
+		bool number_unsigned(json::number_unsigned_t value)
+		{
+			return number(static_cast<double>(value));
+		}
+
+		bool number_float(json::number_float_t value, const json::string_t &)
+		{
+			return number(static_cast<double>(value));
+		}
+
+		bool string(json::string_t &value)
+		{
+			if (stack_.empty()) {
+				return false;
+			}
+
+			auto &&top = stack_.back();
+			switch (top.kind) {
+			case scope::definition:
+				if (top.key == "name") {
+					out_.name = std::move(value);
+				} else if (top.key == "$parent") {
+					out_.parent = std::move(value);
+				}
+				break;
+			case scope::face:
+				if (top.key == "material") {
+					top.face->material = std::move(value);
+				}
+				break;
+			case scope::materials:
+				out_.materials.emplace_back(top.key, std::move(value));
+				break;
+			default:
+				break;
+			}
+			return true;
+		}
+
+		bool binary(json::binary_t &)
+		{
+			return true;
+		}
+
+		bool key(json::string_t &value)
+		{
+			stack_.back().key = std::move(value);
+			return true;
+		}
+
+		bool start_object(size_t)
+		{
+			if (stack_.empty()) {
+				stack_.emplace_back(frame{ scope::definition });
+				return true;
+			}
+
+			auto &&top = stack_.back();
+			if (top.kind == scope::definition && top.key == "materials") {
+				stack_.emplace_back(frame{ scope::materials });
+			} else if (top.kind == scope::components) {
+				out_.def.components.emplace_back();
+				stack_.emplace_back(frame{ scope::component });
+			} else if (top.kind == scope::component && top.key == "face") {
+				stack_.emplace_back(frame{ scope::faces });
+			} else if (top.kind == scope::faces &&
+				   face_from_name(top.key) != voxel_face::_count) {
+				auto &&faces = out_.def.components.back().faces;
+				frame face{ scope::face };
+				face.face = &faces[face_from_name(top.key)];
+				stack_.emplace_back(std::move(face));
+			} else {
+				stack_.emplace_back(frame{ scope::skip });
+			}
+			return true;
+		}
+
+		bool end_object()
+		{
+			stack_.pop_back();
+			return true;
+		}
+
+		bool start_array(size_t)
+		{
+			if (stack_.empty()) {
+				return false;
+			}
+
+			auto &&top = stack_.back();
+			if (top.kind == scope::definition && top.key == "components") {
+				out_.def.components.clear();
+				stack_.emplace_back(frame{ scope::components });
+			} else if (top.kind == scope::component &&
+				   (top.key == "min" || top.key == "max" || top.key == "translate")) {
+				auto &&component = out_.def.components.back();
+				frame vector{ scope::vector };
+				vector.vec3 = top.key == "min"   ? &component.min
+					      : top.key == "max" ? &component.max
+								 : &component.translate;
+				stack_.emplace_back(std::move(vector));
+			} else if (top.kind == scope::face &&
+				   (top.key == "uv_min" || top.key == "uv_max")) {
+				frame vector{ scope::vector };
+				vector.vec2 = top.key == "uv_min" ? &top.face->uv_min : &top.face->uv_max;
+				stack_.emplace_back(std::move(vector));
+			} else {
+				stack_.emplace_back(frame{ scope::skip });
+			}
+			return true;
+		}
+
+		bool end_array()
+		{
+			stack_.pop_back();
+			return true;
+		}
+
+		template <typename Exception>
+		bool parse_error(size_t, const std::string &, const Exception &error)
+		{
+			throw error;
+		}
+
+	    private:
+		bool number(double value)
+		{
+			if (stack_.empty()) {
+				return false;
+			}
+
+			auto &&top = stack_.back();
+			if (top.kind != scope::vector) {
+				return true;
+			}
+
+			// values past the size of the vector are ignored, like from_json does
+			if (top.vec3 != nullptr && top.index < 3) {
+				(*top.vec3)[top.index++] = value;
+			} else if (top.vec2 != nullptr && top.index < 2) {
+				(*top.vec2)[top.index++] = value;
+			}
+			return true;
+		}
+
+		voxel_source &out_;
+		std::vector<frame> stack_;
+	};
+} // namespace internal
+
+/// Reads a definition from json text without building a json document.
+static voxel_source parse_voxel_source(std::string_view text)
+{
+	voxel_source source;
+	internal::voxel_sax sax{ source };
+	// the handlers only stop the parse at a top level value that isn't an object
+	if (!nlohmann::json::sax_parse(text.data(), text.data() + text.size(), &sax)) {
+		internal::throw_not_an_object();
+	}
+	return source;
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_CORE_VOXEL_PARSER_HPP
@@ -0,0 +1,548 @@
+#ifndef WEAVER_CORE_VOXEL_RELOADER_HPP
+#define WEAVER_CORE_VOXEL_RELOADER_HPP
+
+#include "../config/config.hpp"
+#include "attributes.hpp"
+#include "hash.hpp"
+#include "material_registry.hpp"
+#include "thread_pool.hpp"
+#include "voxel_loader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#	define WEAVER_INOTIFY 1
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#else
+#	define WEAVER_INOTIFY 0
+#endif
+
+namespace tc
+{
+namespace weaver
+{
+namespace internal
+{
+	/// Reports the files of a directory that were written, moved or removed.
+	/// Uses inotify on Linux, elsewhere file sizes and modification times are
+	/// compared on every call.
+	class directory_watch {
+		using stamp = std::pair<uintmax_t, int64_t>;
+
+	    public:
+		explicit directory_watch(std::string dir) : dir_{ std::move(dir) }
+		{
+#if WEAVER_INOTIFY
+			fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd_ >= 0 &&
+			    ::inotify_add_watch(fd_, dir_.c_str(),
+						IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+				::close(fd_);
+				fd_ = -1;
+			}
+#endif
+			if (fd_ < 0) {
+				std::vector<std::string> ignored;
+				scan(ignored);
+			}
+		}
+
+		directory_watch(const directory_watch &) = delete;
+		directory_watch &operator=(const directory_watch &) = delete;
+
+		~directory_watch()
+		{
+#if WEAVER_INOTIFY
+			if (fd_ >= 0) {
+				::close(fd_);
+			}
+#endif
+		}
+
+		/// Adds the names of the files changed since the last call to files.
+		/// Returns false when changes were lost and every file has to be checked.
+		bool changes(std::vector<std::string> &files)
+		{
+#if WEAVER_INOTIFY
+			if (fd_ >= 0) {
+				return read_events(files);
+			}
+#endif
+			scan(files);
+			return true;
+		}
+
+	    private:
+#if WEAVER_INOTIFY
+		bool read_events(std::vector<std::string> &files)
+		{
+			bool complete{ true };
+			alignas(inotify_event) char buffer[4096];
+			for (;;) {
+				const auto size = ::read(fd_, buffer, sizeof(buffer));
+				if (size <= 0) {
+					return complete;
+				}
+
+				for (auto p = buffer; p < buffer + size;) {
+					auto event = reinterpret_cast<const inotify_event *>(p);
+					if (event->mask & IN_Q_OVERFLOW) {
+						complete = false;
+					} else if (event->len > 0) {
+						files.emplace_back(event->name);
+					}
+					p += sizeof(inotify_event) + event->len;
+				}
+			}
+		}
+#endif
+
+		void scan(std::vector<std::string> &files)
+		{
+			namespace fs = std::filesystem;
+
+			std::unordered_map<std::string, stamp> stamps;
+			for (const auto &entry : fs::directory_iterator(dir_)) {
+				auto name = entry.path().filename().string();
+				const stamp s{ entry.file_size(),
+					       static_cast<int64_t>(
+						       entry.last_write_time().time_since_epoch().count()) };
+
+				auto it = stamps_.find(name);
+				if (it == std::end(stamps_) || it->second != s) {
+					files.emplace_back(name);
+				}
+				stamps.emplace(std::move(name), s);
+			}
+
+			for (auto &&pair : stamps_) {
+				if (stamps.count(pair.first) == 0) {
+					files.emplace_back(pair.first);
+				}
+			}
+
+			stamps_ = std::move(stamps);
+		}
+
+		std::string dir_;
+		int fd_{ -1 };
+		std::unordered_map<std::string, stamp> stamps_;
+	};
+} // namespace internal
+
+/// A definition published by voxel_reloader, shared by every snapshot it is
+/// part of and never modified once published.
+struct WEAVER_API voxel_snapshot_entry {
+	std::string name;
+	/// File of the directory the definition was read from.
+	std::string file;
+	/// The json of the file as written.
+	nlohmann::json source;
+	voxel_def def;
+};
+
+/// The definitions of a voxel_reloader at one point in time. Entries that
+/// didn't change are shared with the previous snapshot, a reload only
+/// allocates the entries it changed.
+struct WEAVER_API voxel_snapshot {
+	using entry_ptr = std::shared_ptr<const voxel_snapshot_entry>;
+
+	const voxel_def *find(std::string_view name) const
+	{
+		auto it = entries.find(name);
+		return it == std::end(entries) ? nullptr : &it->second->def;
+	}
+
+	const voxel_def *find(voxel_id_t type) const
+	{
+		auto it = name_lookup.find(type);
+		return it == std::end(name_lookup) ? nullptr : find(it->second);
+	}
+
+	/// Entries by name, the keys point into the entries.
+	std::unordered_map<std::string_view, entry_ptr> entries;
+	std::unordered_map<voxel_id_t, std::string_view> name_lookup;
+	/// Definitions by voxel_def::index. Indices are kept by names that are
+	/// removed, their entries are null.
+	std::vector<const voxel_def *> by_index;
+	/// Every face material of the definitions, ids only ever grow.
+	std::shared_ptr<const material_registry> materials{
+		std::make_shared<const material_registry>()
+	};
+};
+
+/// A file that failed to load, see voxel_reloader::errors.
+struct WEAVER_API voxel_file_error {
+	std::string file;
+	std::string message;
+};
+
+/// Keeps the definitions of a directory loaded while its files are edited.
+/// poll re-parses the changed files, re-resolves only the definitions whose
+/// $parent chain contains one of them and publishes the result as a new
+/// snapshot. Snapshots are immutable, threads meshing with one keep it alive
+/// and never wait for a reload.
+/// poll and reload are called from one thread, snapshot from any.
+class WEAVER_API voxel_reloader {
+	struct entry {
+		nlohmann::json resolved;
+		std::shared_ptr<const voxel_snapshot_entry> shared;
+	};
+
+    public:
+	using snapshot_ptr = std::shared_ptr<const voxel_snapshot>;
+
+	template <typename Executor>
+	voxel_reloader(std::string dir, Executor &executor) : dir_{ std::move(dir) }, watch_{ dir_ }
+	{
+		reload_all(executor);
+	}
+
+	explicit voxel_reloader(std::string dir) : dir_{ std::move(dir) }, watch_{ dir_ }
+	{
+		thread_pool pool;
+		reload_all(pool);
+	}
+
+	/// The current definitions.
+	snapshot_ptr snapshot() const
+	{
+		return std::atomic_load(&snapshot_);
+	}
+
+	/// Reloads the files changed since the last poll, and the files still
+	/// queued from earlier polls, and returns the type ids whose definitions
+	/// changed, appeared or were removed.
+	/// A file that fails to parse, e.g. one that is still being written, keeps
+	/// its last good definition while the other files are reloaded, see
+	/// errors. When the definitions can't be resolved, for a missing $parent,
+	/// a $parent cycle or colliding type ids, the exception is passed on, the
+	/// snapshot stays as it was and every file of the reload is queued.
+	/// Queued files are retried by every poll until they load.
+	template <typename Executor> std::vector<voxel_id_t> poll(Executor &executor)
+	{
+		std::vector<std::string> files{ std::begin(queued_), std::end(queued_) };
+		if (!watch_.changes(files)) {
+			return reload_all(executor);
+		}
+
+		if (files.empty()) {
+			return {};
+		}
+
+		return reload(std::move(files), executor);
+	}
+
+	std::vector<voxel_id_t> poll()
+	{
+		sequential_executor executor;
+		return poll(executor);
+	}
+
+	/// Files that failed to parse the last time they were reloaded, they are
+	/// queued and keep their last good definitions.
+	const std::vector<voxel_file_error> &errors() const
+	{
+		return errors_;
+	}
+
+	/// Reloads the given files of the directory, see poll.
+	template <typename Executor>
+	std::vector<voxel_id_t> reload(std::vector<std::string> files, Executor &executor)
+	{
+		namespace fs = std::filesystem;
+
+		std::sort(std::begin(files), std::end(files));
+		files.erase(std::unique(std::begin(files), std::end(files)), std::end(files));
+
+		// every file is parsed on its own, a broken one doesn't hold up the others
+		std::vector<std::optional<std::pair<std::string, nlohmann::json>>> parsed(files.size());
+		std::vector<std::optional<std::string>> failed(files.size());
+		executor.parallel_for(files.size(), [&](size_t index, size_t) {
+			const auto path = fs::path{ dir_ } / files[index];
+			try {
+				if (fs::is_regular_file(path)) {
+					parsed[index] = load_voxel_file(path);
+				}
+			} catch (const std::exception &e) {
+				failed[index] = e.what();
+			}
+		});
+
+		try {
+			auto changed_ids = apply(files, parsed, failed, executor);
+
+			// files that aren't part of this reload stay queued with their errors
+			for (auto &&file : files) {
+				queued_.erase(file);
+			}
+			errors_.erase(std::remove_if(std::begin(errors_), std::end(errors_),
+						     [&files](auto &&error) {
+							     return std::binary_search(std::begin(files),
+										       std::end(files),
+										       error.file);
+						     }),
+				      std::end(errors_));
+			for (size_t i = 0; i < files.size(); ++i) {
+				if (failed[i]) {
+					queued_.emplace(files[i]);
+					errors_.emplace_back(voxel_file_error{ files[i], std::move(*failed[i]) });
+				}
+			}
+
+			return changed_ids;
+		} catch (...) {
+			queued_.insert(std::begin(files), std::end(files));
+			throw;
+		}
+	}
+
+	/// Reloads every file of the directory and every file loaded before.
+	template <typename Executor> std::vector<voxel_id_t> reload_all(Executor &executor)
+	{
+		std::vector<std::string> files{ std::begin(queued_), std::end(queued_) };
+		for (const auto &entry : std::filesystem::directory_iterator(dir_)) {
+			files.emplace_back(entry.path().filename().string());
+		}
+		for (auto &&pair : files_) {
+			files.emplace_back(pair.first);
+		}
+
+		return reload(std::move(files), executor);
+	}
+
+    private:
+	/// Resolves the parsed files together with the unchanged definitions and
+	/// publishes the result. Nothing is changed when it throws. Files that
+	/// failed to parse keep the definitions they had.
+	template <typename Executor>
+	std::vector<voxel_id_t>
+	apply(const std::vector<std::string> &files,
+	      std::vector<std::optional<std::pair<std::string, nlohmann::json>>> &parsed,
+	      const std::vector<std::optional<std::string>> &failed, Executor &executor)
+	{
+		// definitions after the reload, the changed ones point into parsed
+		std::map<std::string_view, const nlohmann::json *> next;
+		std::map<std::string_view, size_t> changed;
+		for (auto &&pair : entries_) {
+			next.emplace(pair.first, &pair.second.shared->source);
+		}
+		for (size_t i = 0; i < files.size(); ++i) {
+			auto it = files_.find(files[i]);
+			if (!failed[i] && it != std::end(files_)) {
+				next.erase(it->second);
+			}
+		}
+		for (size_t i = 0; i < files.size(); ++i) {
+			if (parsed[i]) {
+				auto &&name = parsed[i]->first;
+				next.insert_or_assign(name, &parsed[i]->second);
+				changed.insert_or_assign(name, i);
+			}
+		}
+
+		std::vector<std::string_view> names;
+		std::vector<const nlohmann::json *> sources;
+		names.reserve(next.size());
+		sources.reserve(next.size());
+		for (auto &&pair : next) {
+			names.emplace_back(pair.first);
+			sources.emplace_back(pair.second);
+		}
+
+		const auto count = names.size();
+		const auto parents = internal::parent_indices(names, sources);
+
+		// changed definitions and everything inheriting from them
+		std::vector<std::vector<size_t>> children(count);
+		std::vector<bool> selected(count, false);
+		std::vector<size_t> pending;
+		for (size_t i = 0; i < count; ++i) {
+			if (parents[i] != internal::no_parent) {
+				children[parents[i]].emplace_back(i);
+			}
+
+			if (changed.count(names[i]) != 0 || entries_.count(names[i]) == 0) {
+				selected[i] = true;
+				pending.emplace_back(i);
+			}
+		}
+		while (!pending.empty()) {
+			const auto i = pending.back();
+			pending.pop_back();
+			for (auto child : children[i]) {
+				if (!selected[child]) {
+					selected[child] = true;
+					pending.emplace_back(child);
+				}
+			}
+		}
+
+		std::vector<nlohmann::json> resolved(count);
+		std::vector<nlohmann::json *> targets(count);
+		for (size_t i = 0; i < count; ++i) {
+			targets[i] = selected[i] ? &resolved[i] : &entries_.find(names[i])->second.resolved;
+		}
+		internal::resolve_definitions(names, sources, parents, selected, targets, executor);
+
+		std::vector<voxel_def> defs(count);
+		executor.parallel_for(count, [&](size_t i, size_t) {
+			if (selected[i]) {
+				defs[i] = resolved[i];
+			}
+		});
+
+		std::vector<std::pair<voxel_id_t, std::string_view>> ids(count);
+		for (size_t i = 0; i < count; ++i) {
+			const auto type =
+				selected[i] ? defs[i].type : entries_.find(names[i])->second.shared->def.type;
+			ids[i] = std::make_pair(type, names[i]);
+		}
+		internal::check_type_ids(std::move(ids));
+
+		// everything succeeded, apply the changes
+		std::vector<voxel_id_t> changed_ids;
+		for (auto it = std::begin(entries_); it != std::end(entries_);) {
+			if (next.count(it->first) == 0) {
+				changed_ids.emplace_back(it->second.shared->def.type);
+				it = entries_.erase(it);
+			} else {
+				++it;
+			}
+		}
+		for (size_t i = 0; i < count; ++i) {
+			if (!selected[i]) {
+				continue;
+			}
+
+			auto it = entries_.find(names[i]);
+			if (it == std::end(entries_)) {
+				it = entries_.emplace(std::string{ names[i] }, entry{}).first;
+			}
+
+			auto &&e = it->second;
+			const auto c = changed.find(names[i]);
+			const bool same = !e.resolved.is_null() && e.resolved == resolved[i];
+			if (same && c == std::end(changed)) {
+				// re-resolved for its parent, which didn't reach it
+				continue;
+			}
+
+			if (!same) {
+				changed_ids.emplace_back(defs[i].type);
+			}
+
+			// published entries are shared with older snapshots, edits make new ones
+			auto shared = std::make_shared<voxel_snapshot_entry>();
+			shared->name = it->first;
+			if (c != std::end(changed)) {
+				shared->file = files[c->second];
+				shared->source = std::move(parsed[c->second]->second);
+			} else {
+				shared->file = e.shared->file;
+				shared->source = e.shared->source;
+			}
+
+			if (same) {
+				// an edit that doesn't reach the resolved definition changes nothing
+				shared->def = e.shared->def;
+			} else {
+				shared->def = std::move(defs[i]);
+				shared->def.index = index_of(it->first);
+
+				for (auto &&component : shared->def.components) {
+					for (size_t f = 0; f < static_cast<size_t>(voxel_face::_count); ++f) {
+						auto face = component.faces.find(static_cast<voxel_face>(f));
+						if (face != std::end(component.faces)) {
+							materials_.intern(face->second.material);
+						}
+					}
+				}
+			}
+
+			e.resolved = std::move(resolved[i]);
+			e.shared = std::move(shared);
+		}
+
+		files_.clear();
+		for (auto &&pair : entries_) {
+			files_.emplace(pair.second.shared->file, pair.first);
+		}
+
+		publish();
+
+		std::sort(std::begin(changed_ids), std::end(changed_ids));
+		changed_ids.erase(std::unique(std::begin(changed_ids), std::end(changed_ids)),
+				  std::end(changed_ids));
+		return changed_ids;
+	}
+
+	/// Index of a definition name, names keep their index after being removed
+	/// so voxels holding one never point at another definition. New names are
+	/// numbered in name order within a reload.
+	uint32_t index_of(const std::string &name)
+	{
+		auto it = indices_.find(name);
+		if (it == std::end(indices_)) {
+			it = indices_.emplace(name, static_cast<uint32_t>(indices_.size())).first;
+		}
+
+		return it->second;
+	}
+
+	/// Publishes the entries as a new snapshot. Only pointers to the entries
+	/// are copied, material ids and indices only ever grow so meshes made with
+	/// an older snapshot keep their meaning.
+	void publish()
+	{
+		auto snapshot = std::make_shared<voxel_snapshot>();
+		snapshot->entries.reserve(entries_.size());
+		snapshot->name_lookup.reserve(entries_.size());
+		snapshot->by_index.resize(indices_.size(), nullptr);
+		for (auto &&pair : entries_) {
+			auto &&shared = pair.second.shared;
+			snapshot->entries.emplace(shared->name, shared);
+			snapshot->name_lookup.emplace(shared->def.type, shared->name);
+			snapshot->by_index[shared->def.index] = &shared->def;
+		}
+
+		auto previous = std::atomic_load(&snapshot_);
+		if (previous->materials->size() == materials_.size()) {
+			snapshot->materials = previous->materials;
+		} else {
+			snapshot->materials = std::make_shared<const material_registry>(materials_);
+		}
+
+		std::atomic_store(&snapshot_, snapshot_ptr{ std::move(snapshot) });
+	}
+
+	std::string dir_;
+	internal::directory_watch watch_;
+	std::map<std::string, entry, std::less<>> entries_;
+	/// Definition name of every file.
+	std::unordered_map<std::string, std::string> files_;
+	/// Files to load again on the next poll.
+	std::set<std::string> queued_;
+	std::vector<voxel_file_error> errors_;
+	material_registry materials_;
+	/// Dense index of every definition name seen, see index_of.
+	std::unordered_map<std::string, uint32_t> indices_;
+	snapshot_ptr snapshot_{ std::make_shared<const voxel_snapshot>() };
+};
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_CORE_VOXEL_RELOADER_HPP
@@ -2,7 +2,15 @@
 #define WEAVER_MESHER_HPP
 
 #include "mesher/fwd.hpp"
+#include "mesher/output.hpp"
+#include "mesher/volume_view.hpp"
+#include "mesher/batch.hpp"
+#include "mesher/binary_culling.hpp"
 #include "mesher/culling.hpp"
+#include "mesher/greedy.hpp"
+#include "mesher/incremental.hpp"
+#include "mesher/mesh_cache.hpp"
 #include "mesher/simple.hpp"
+#include "mesher/voxel_table.hpp"
 
 #endif // WEAVER_MESHER_HPP
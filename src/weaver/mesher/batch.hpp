@@ -0,0 +1,92 @@
+#ifndef WEAVER_MESHER_BATCH_HPP
+#define WEAVER_MESHER_BATCH_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/thread_pool.hpp"
+#include "voxel_reader.hpp"
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+/// Voxels of one chunk, stored the way the mesher's eval expects them.
+template <typename Iter> struct WEAVER_API chunk_desc {
+	Iter begin() const
+	{
+		return first;
+	}
+
+	Iter end() const
+	{
+		return last;
+	}
+
+	Iter first{};
+	Iter last{};
+};
+
+/// Meshers may provide a `scratch_type` and
+/// `eval(Iter, Iter, reader, scratch_type &)` to mesh with buffers that are
+/// kept from one eval to the next.
+template <typename Mesher, typename = void> struct has_scratch : std::false_type {
+};
+
+template <typename Mesher>
+struct has_scratch<Mesher, std::void_t<typename Mesher::scratch_type>> : std::true_type {
+};
+
+template <typename Mesher> static constexpr bool has_scratch_v = has_scratch<Mesher>::value;
+
+/// Meshes every chunk of a random access range with the executor, e.g. a
+/// weaver::thread_pool. Chunks are anything providing begin() and end(), like
+/// chunk_desc or a container of voxels.
+/// Each worker meshes with its own copy of the mesher and reader so neither
+/// has to be thread safe, and with its own scratch when the mesher has one,
+/// so the buffers of an eval are allocated once per worker rather than once
+/// per chunk. Results are in the order of the chunks.
+template <typename Mesher, typename Range, typename Reader, typename Executor>
+std::vector<typename Mesher::result_type> mesh_batch(const Mesher &mesher, const Range &chunks,
+						     const Reader &reader, Executor &executor)
+{
+	const auto first = std::begin(chunks);
+	const auto count = static_cast<size_t>(std::distance(first, std::end(chunks)));
+
+	std::vector<typename Mesher::result_type> results(count);
+	std::vector<Mesher> meshers(executor.workers(), mesher);
+	std::vector<Reader> readers(executor.workers(), reader);
+
+	if constexpr (has_scratch_v<Mesher>) {
+		std::vector<typename Mesher::scratch_type> scratch(executor.workers());
+		executor.parallel_for(count, [&](size_t index, size_t worker) {
+			auto &&chunk = *(first + index);
+			results[index] = meshers[worker].eval(std::begin(chunk), std::end(chunk),
+							      readers[worker], scratch[worker]);
+		});
+	} else {
+		executor.parallel_for(count, [&](size_t index, size_t worker) {
+			auto &&chunk = *(first + index);
+			results[index] = meshers[worker].eval(std::begin(chunk), std::end(chunk),
+							      readers[worker]);
+		});
+	}
+
+	return results;
+}
+
+/// mesh_batch with a default constructed reader.
+template <typename Mesher, typename Range, typename Executor>
+std::vector<typename Mesher::result_type> mesh_batch(const Mesher &mesher, const Range &chunks,
+						     Executor &executor)
+{
+	using voxel_t = std::remove_cv_t<std::remove_reference_t<decltype(
+		*std::begin(*std::begin(chunks)))>>;
+	return mesh_batch(mesher, chunks, voxel_reader<voxel_t>{}, executor);
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_BATCH_HPP
@@ -0,0 +1,282 @@
+#ifndef WEAVER_MESHER_BINARY_CULLING_HPP
+#define WEAVER_MESHER_BINARY_CULLING_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "fwd.hpp"
+#include "voxel_reader.hpp"
+#include "mesher_result.hpp"
+#include "output.hpp"
+#include "welder.hpp"
+#include "cube_def.hpp"
+#include "culling.hpp"
+#include "volume_view.hpp"
+#include "voxel_table.hpp"
+#include <array>
+#include <type_traits>
+#include <vector>
+#include "../core/algorithm.hpp"
+#include "../core/voxel_face.hpp"
+
+namespace tc
+{
+/// Culling mesher working on a packed occupancy volume, one 64 bit word per
+/// x column. Exposed faces are found with shifts and and-not operations for
+/// a whole column at a time, producing the same quads as tc::culling.
+///
+/// The per face cull flags of a voxel are cached by type id for readers
+/// declaring weaver::faces_by_type, see weaver::cull_mask_cache.
+/// Chunks wider than 64 voxels are handed to tc::culling.
+template <typename Type, typename Output = quad_output> class WEAVER_API binary_culling {
+	template <typename T> using reader_t = weaver::voxel_reader<T>;
+	using column_t = uint64_t;
+
+	static constexpr auto face_count = static_cast<size_t>(voxel_face::_count);
+	static constexpr int32_t column_bits = 64;
+
+	struct occupancy {
+		/// Visible voxels, bit x of column y + z * (height + 2).
+		std::vector<column_t> solid;
+		/// Visible voxels culling the face of the neighbor they touch with face d.
+		std::array<std::vector<column_t>, face_count> cull;
+		/// Cull flags of the border voxels before and after the x range.
+		std::vector<column_t> cull_left_border;
+		std::vector<column_t> cull_right_border;
+	};
+
+    public:
+	using result_type = typename Output::result_type;
+
+	/// Buffers of an eval, see culling::scratch_type.
+	struct scratch_type {
+		occupancy bits;
+		weaver::cull_mask_cache cull_masks;
+		/// Scratch of the tc::culling wide chunks are handed to.
+		typename culling<Type, Output>::scratch_type fallback;
+	};
+
+	template <typename Iter>
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
+	{
+		scratch_type scratch;
+		return eval(volume_begin, volume_end, std::move(reader), scratch);
+	}
+
+	template <typename Iter>
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader,
+			 scratch_type &scratch) const
+	{
+		if (add_border) {
+			return eval(weaver::volume_view<Iter>{ volume_begin, volume_end, width, height,
+							       depth },
+				    reader, scratch);
+		} else {
+			return eval(weaver::padded_volume_view<Iter>{ volume_begin, volume_end, width,
+								      height, depth },
+				    reader, scratch);
+		}
+	}
+
+	/// Meshes the chunk culling its boundary faces against the given neighbours,
+	/// see weaver::neighbor_view. add_border is ignored.
+	template <typename Iter>
+	weaver::neighbor_mesh<result_type> eval(Iter volume_begin, Iter volume_end,
+					  const weaver::chunk_neighbors<Iter> &neighbors,
+					  reader_t<Type> reader = {}) const
+	{
+		weaver::neighbor_view<Iter> view{ volume_begin, volume_end, width,
+						  height, depth, neighbors };
+		return { eval(view, reader), view.planes() };
+	}
+
+	/// Meshes the view's chunk, width, height, depth and add_border are taken from the view.
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader = {}) const
+	{
+		scratch_type scratch;
+		return eval(view, std::move(reader), scratch);
+	}
+
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader, scratch_type &scratch) const
+	{
+		if (view.width() > column_bits) {
+			culling<Type, Output> fallback;
+			fallback.indexed = indexed;
+			fallback.reserve_faces = reserve_faces;
+			fallback.count_faces = count_faces;
+			return fallback.eval(view, reader, scratch.fallback);
+		}
+
+		result_type result;
+
+		auto &&bits = scratch.bits;
+		build_occupancy(view, reader, bits, scratch.cull_masks);
+
+		// the occupancy is shared by both passes, counting only costs the face queries
+		auto faces = reserve_faces;
+		if (count_faces) {
+			faces = 0;
+			mesh<weaver::internal::face_counter>(bits, view, reader, faces);
+		}
+
+		Output::reserve(result, faces);
+		mesh<Output>(bits, view, reader, result);
+
+		if constexpr (std::is_same_v<result_type, mesher_result>) {
+			if (indexed) {
+				weaver::weld_quads(result);
+			}
+		}
+
+		return result;
+	}
+
+	size_t width{ 0 };
+	size_t height{ 0 };
+	size_t depth{ 0 };
+	bool add_border{ false };
+	/// Output welded, indexed vertices instead of quads, see weaver::weld_quads.
+	bool indexed{ false };
+	/// Faces to reserve output for up front, unused when count_faces is set.
+	size_t reserve_faces{ 0 };
+	/// Count the visible faces in a first pass so the output is allocated once.
+	bool count_faces{ false };
+
+    private:
+	template <typename Sink, typename View>
+	void mesh(const occupancy &bits, const View &view, reader_t<Type> &reader,
+		  typename Sink::result_type &result) const
+	{
+		const int32_t dw{ view.width() };
+		const int32_t dh{ view.height() };
+		const int32_t dd{ view.depth() };
+		const int32_t bh{ dh + 2 };
+
+		const column_t last_bit = column_t{ 1 } << (dw - 1);
+		static constexpr auto r = static_cast<size_t>(voxel_face::right);
+		static constexpr auto b = static_cast<size_t>(voxel_face::back);
+		static constexpr auto t = static_cast<size_t>(voxel_face::top);
+		static constexpr auto l = static_cast<size_t>(voxel_face::left);
+		static constexpr auto f = static_cast<size_t>(voxel_face::front);
+		static constexpr auto d = static_cast<size_t>(voxel_face::bottom);
+
+		for (auto z = 1; z <= dd; ++z) {
+			for (auto y = 1; y <= dh; ++y) {
+				const auto col = y + z * bh;
+				const auto s = bits.solid[col];
+				if (s == 0) {
+					continue;
+				}
+
+				// a face is hidden when the neighbor culls its opposite face
+				std::array<column_t, face_count> exposed{};
+				exposed[r] = s & ~((bits.cull[l][col] >> 1) |
+						   (bits.cull_right_border[col] ? last_bit : 0));
+				exposed[l] = s & ~((bits.cull[r][col] << 1) | bits.cull_left_border[col]);
+				exposed[b] = s & ~bits.cull[f][col + 1];
+				exposed[f] = s & ~bits.cull[b][col - 1];
+				exposed[t] = s & ~bits.cull[d][col + bh];
+				exposed[d] = s & ~bits.cull[t][col - bh];
+
+				column_t any{ 0 };
+				for (auto &&e : exposed) {
+					any |= e;
+				}
+
+				while (any != 0) {
+					const auto x = weaver::countr_zero(any);
+					any &= any - 1;
+
+					const column_t bit = column_t{ 1 } << x;
+					auto volume = view.at(x, y - 1, z - 1);
+					auto type_id = reader(*volume);
+					const vertex vert{ static_cast<weaver::decimal_t>(x),
+							   static_cast<weaver::decimal_t>(y - 1),
+							   static_cast<weaver::decimal_t>(z - 1) };
+
+					for (size_t i = 0; i < face_count; ++i) {
+						if (exposed[i] & bit) {
+							add_quad<Sink>(static_cast<int32_t>(i), vert,
+								       result, type_id, volume, reader);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template <typename View>
+	void build_occupancy(const View &view, reader_t<Type> &reader, occupancy &bits,
+			     weaver::cull_mask_cache &cull_masks) const
+	{
+		const int32_t dw{ view.width() };
+		const int32_t dh{ view.height() };
+		const int32_t dd{ view.depth() };
+		const int32_t bh{ dh + 2 };
+		const int32_t bd{ dd + 2 };
+
+		const size_t columns = bh * bd;
+		bits.solid.assign(columns, 0);
+		for (auto &&c : bits.cull) {
+			c.assign(columns, 0);
+		}
+		bits.cull_left_border.assign(columns, 0);
+		bits.cull_right_border.assign(columns, 0);
+
+		cull_masks.clear();
+
+		for (auto z = 0; z < bd; ++z) {
+			for (auto y = 0; y < bh; ++y) {
+				const auto col = y + z * bh;
+				for (auto x = -1; x <= dw; ++x) {
+					auto volume = view.at(x, y - 1, z - 1);
+					if (volume == nullptr || !reader.visible(*volume)) {
+						continue;
+					}
+
+					const auto mask = cull_masks(reader, *volume);
+					if (x == -1) {
+						if (mask & (1 << static_cast<size_t>(voxel_face::right))) {
+							bits.cull_left_border[col] = 1;
+						}
+						continue;
+					} else if (x == dw) {
+						if (mask & (1 << static_cast<size_t>(voxel_face::left))) {
+							bits.cull_right_border[col] = 1;
+						}
+						continue;
+					}
+
+					const column_t bit = column_t{ 1 } << x;
+					bits.solid[col] |= bit;
+					for (size_t i = 0; i < face_count; ++i) {
+						if (mask & (1 << i)) {
+							bits.cull[i][col] |= bit;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template <typename Sink, typename Ptr>
+	auto add_quad(int32_t direction, const vertex &vert, typename Sink::result_type &result,
+		      weaver::voxel_id_t type_id, Ptr current_vox, reader_t<Type> &reader) const
+	{
+		auto dir = static_cast<voxel_face>(direction);
+
+		if constexpr (std::is_same_v<Sink, weaver::internal::face_counter>) {
+			result += weaver::count_faces(reader, *current_vox, dir);
+			return;
+		}
+
+		uint32_t component{ 0 };
+		weaver::for_each_quad(reader, *current_vox, dir, type_id, vert, [&](auto &&face) {
+			Sink::emit(result, face, weaver::face_info{ vector3i{ vert }, dir, component++ });
+		});
+	}
+};
+} // namespace tc
+
+#endif // WEAVER_MESHER_BINARY_CULLING_HPP
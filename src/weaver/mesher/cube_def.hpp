@@ -3,6 +3,7 @@
 
 #include "../config/config.hpp"
 #include "../core/attributes.hpp"
+#include "../core/vector3.hpp"
 #include "../core/vertex.hpp"
 #include "../core/quad.hpp"
 #include "fwd.hpp"
@@ -36,21 +37,22 @@ struct WEAVER_API cube_def {
 			quad{ c, d, b, a }, // Bottom face
 		};
 
-		std::array<vector2d, 4> uv;
+		using uv_t = quad::uv_t;
+		std::array<uv_t, 4> uv;
 		if constexpr (WEAVER_UV_BOTTOM_LEFT_ORIGIN) {
-			uv = std::array<vector2d, 4>{
-				vector2d{ 0.0, 0.0 }, // UV Bottom left
-				vector2d{ 1.0, 0.0 }, // UV Bottom right
-				vector2d{ 1.0, 1.0 }, // UV Top Right
-				vector2d{ 0.0, 1.0 }, // UV Top Left
+			uv = std::array<uv_t, 4>{
+				uv_t{ 0.0, 0.0 }, // UV Bottom left
+				uv_t{ 1.0, 0.0 }, // UV Bottom right
+				uv_t{ 1.0, 1.0 }, // UV Top Right
+				uv_t{ 0.0, 1.0 }, // UV Top Left
 			};
 		}
 		else {
-			uv = std::array<vector2d, 4>{
-				vector2d{ 0.0, 1.0 }, // UV Bottom left
-				vector2d{ 1.0, 1.0 }, // UV Bottom right
-				vector2d{ 1.0, 0.0 }, // UV Top Right
-				vector2d{ 0.0, 0.0 }, // UV Top Left
+			uv = std::array<uv_t, 4>{
+				uv_t{ 0.0, 1.0 }, // UV Bottom left
+				uv_t{ 1.0, 1.0 }, // UV Bottom right
+				uv_t{ 1.0, 0.0 }, // UV Top Right
+				uv_t{ 0.0, 0.0 }, // UV Top Left
 			};
 		}
 		
@@ -66,6 +68,16 @@ struct WEAVER_API cube_def {
 	}
 };
 static constexpr auto cube_faces = cube_def::build_faces();
+
+/// Step from a voxel to the neighbour behind each of its faces, indexed by voxel_face.
+static constexpr std::array<vector3i, 6> face_offsets{
+	vector3i{ 1, 0, 0 },  // Right
+	vector3i{ 0, 1, 0 },  // Back
+	vector3i{ 0, 0, 1 },  // Top
+	vector3i{ -1, 0, 0 }, // Left
+	vector3i{ 0, -1, 0 }, // Front
+	vector3i{ 0, 0, -1 }, // Bottom
+};
 } // namespace tc
 
 #endif // WEAVER_MESHER_CUBE_DEF_HPP
\ No newline at end of file
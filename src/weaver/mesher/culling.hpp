@@ -6,205 +6,392 @@
 #include "fwd.hpp"
 #include "voxel_reader.hpp"
 #include "mesher_result.hpp"
+#include "output.hpp"
+#include "welder.hpp"
 #include "cube_def.hpp"
+#include "volume_view.hpp"
+#include "face_kernels.hpp"
+#include "voxel_table.hpp"
+#include <algorithm>
 #include <array>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "../core/algorithm.hpp"
+#include "../core/thread_pool.hpp"
 #include "../core/voxel_face.hpp"
 
 namespace tc
 {
-template <typename Type> class WEAVER_API culling {
+/// Mesher emitting every face of a visible voxel its neighbour doesn't hide.
+/// A chunk of a single type whose voxels hide all their faces is only meshed
+/// on its outer layer. Readers declaring weaver::faces_by_type have what the
+/// faces of a voxel hide looked up once per type id, see
+/// weaver::cull_mask_cache.
+template <typename Type, typename Output = quad_output> class WEAVER_API culling {
 	template <typename T> using reader_t = weaver::voxel_reader<T>;
+	template <typename> friend class incremental;
 	enum boundry { r = 0, f = 1, u = 2, count = 3 };
 
     public:
+	using result_type = typename Output::result_type;
+
+	/// Buffers of an eval, passing the same scratch to consecutive evals on
+	/// one thread saves allocating them every time, see weaver::mesh_batch.
+	struct scratch_type {
+		std::vector<uint8_t> layers;
+		std::vector<uint8_t> faces;
+		weaver::cull_mask_cache cull_masks;
+	};
+
 	template <typename Iter>
-	mesher_result eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
 	{
-		if (add_border) {
-			int32_t dw{ static_cast<int32_t>(width) };
-			int32_t dh{ static_cast<int32_t>(height) };
-			int32_t dd{ static_cast<int32_t>(depth) };
-			int32_t bw{ dw + 2 };
-			int32_t bh{ dh + 2 };
-			int32_t bd{ dd + 2 };
-
-			std::vector<Type *> volume;
-			volume.resize(bw * bh * bd, nullptr);
-			for (auto z = 0; z < dd; ++z) {
-				auto zb = (z + 1) * bh * bw;
-				auto zi = z * dh * dw;
-				for (auto y = 0; y < dh; ++y) {
-					auto yb = (y + 1) * bh + zb;
-					auto yi = y * dh + zi;
-					for (auto x = 0; x < dw; ++x) {
-						auto b = (x + 1) + yb;
-						auto i = x + yi;
-						volume[b] = (volume_begin + i).operator->();
-					}
-				}
-			}
+		scratch_type scratch;
+		return eval(volume_begin, volume_end, std::move(reader), scratch);
+	}
 
-			return work(std::begin(volume), std::end(volume),
-				    reader_t<Type *>{ reader });
+	template <typename Iter>
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader,
+			 scratch_type &scratch) const
+	{
+		if (add_border) {
+			return eval(weaver::volume_view<Iter>{ volume_begin, volume_end, width, height,
+							       depth },
+				    reader, scratch);
 		} else {
-			return work(volume_begin, volume_end, reader);
+			return eval(weaver::padded_volume_view<Iter>{ volume_begin, volume_end, width,
+								      height, depth },
+				    reader, scratch);
 		}
 	}
 
+	/// Meshes the chunk culling its boundary faces against the given neighbours,
+	/// see weaver::neighbor_view. add_border is ignored.
+	template <typename Iter>
+	weaver::neighbor_mesh<result_type> eval(Iter volume_begin, Iter volume_end,
+					  const weaver::chunk_neighbors<Iter> &neighbors,
+					  reader_t<Type> reader = {}) const
+	{
+		weaver::neighbor_view<Iter> view{ volume_begin, volume_end, width,
+						  height, depth, neighbors };
+		return { eval(view, reader), view.planes() };
+	}
+
+	/// Meshes the view's chunk, width, height, depth and add_border are taken from the view.
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader = {}) const
+	{
+		scratch_type scratch;
+		return eval(view, std::move(reader), scratch);
+	}
+
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader, scratch_type &scratch) const
+	{
+		return eval_content(view, reader, weaver::scan_content(view, reader), scratch);
+	}
+
 	size_t width{ 0 };
 	size_t height{ 0 };
 	size_t depth{ 0 };
 	bool add_border{ false };
+	/// Output welded, indexed vertices instead of quads, see weaver::weld_quads.
+	bool indexed{ false };
+	/// Faces to reserve output for up front, unused when count_faces is set.
+	size_t reserve_faces{ 0 };
+	/// Count the visible faces in a first pass so the output is allocated once.
+	bool count_faces{ false };
+	/// Pool to mesh slabs of slab_depth z layers on concurrently, the output is
+	/// the same as meshing on the calling thread. Must not be the pool eval runs on.
+	weaver::thread_pool *pool{ nullptr };
+	size_t slab_depth{ 16 };
 
     private:
-	template <typename Iter, typename T>
-	mesher_result work(Iter volume_begin, Iter volume_end, reader_t<T> reader = {}) const
+	template <typename View>
+	result_type eval_content(const View &view, reader_t<Type> &reader,
+				 weaver::chunk_content content, scratch_type &scratch) const
 	{
-		int32_t dw{ static_cast<int32_t>(width) };
-		int32_t dh{ static_cast<int32_t>(height) };
-		int32_t dd{ static_cast<int32_t>(depth) };
-		int32_t bw{ dw + 2 };
-		int32_t bh{ dh + 2 };
-		int32_t bd{ dd + 2 };
+		result_type result;
+		if (content == weaver::chunk_content::empty) {
+			return result;
+		}
 
-		mesher_result result;
-		auto &quads = result.quads;
+		// only the outer layer of a solid chunk can have visible faces
+		const bool shell = content == weaver::chunk_content::solid;
 
-		quads.reserve(height * width * depth * 6);
+		const int32_t dd{ view.depth() };
+		if (!shell && pool != nullptr && pool->workers() > 1 && slab_depth > 0 &&
+		    dd > static_cast<int32_t>(slab_depth)) {
+			mesh_slabs(view, reader, result);
+		} else {
+			mesh_range(view, reader, scratch, result, 0, dd, reserve_faces, shell);
+		}
 
-		auto volume_check = [reader = reader, e = volume_end](auto c) {
-			if (c >= e) {
-				return false;
+		if constexpr (std::is_same_v<result_type, mesher_result>) {
+			if (indexed) {
+				weaver::weld_quads(result);
 			}
+		}
 
-			return reader.visible(*c);
-		};
+		return result;
+	}
+
+	template <typename View>
+	void mesh_range(const View &view, reader_t<Type> &reader, scratch_type &scratch,
+			result_type &result, int32_t z_begin, int32_t z_end, size_t faces,
+			bool shell = false) const
+	{
+		if (count_faces) {
+			faces = 0;
+			mesh<weaver::internal::face_counter>(view, reader, scratch, faces, z_begin,
+							     z_end, shell);
+		}
+
+		Output::reserve(result, faces);
+		mesh<Output>(view, reader, scratch, result, z_begin, z_end, shell);
+	}
 
-		auto check_neighbor = [reader = reader, volume_check](auto c, auto dir) {
-			auto defs = reader(*c, dir);
-			for (auto &&d : defs) {
-				if (d.cull) {
-					return true;
+	template <typename View>
+	void mesh_slabs(const View &view, reader_t<Type> &reader, result_type &result) const
+	{
+		const auto layers = static_cast<int32_t>(slab_depth);
+		const auto slabs = static_cast<size_t>((view.depth() + layers - 1) / layers);
+		const auto faces = reserve_faces / slabs;
+
+		std::vector<result_type> parts(slabs);
+		std::vector<reader_t<Type>> readers(pool->workers(), reader);
+		std::vector<scratch_type> scratch(pool->workers());
+		pool->parallel_for(slabs, [&](size_t slab, size_t worker) {
+			const auto z_begin = static_cast<int32_t>(slab) * layers;
+			const auto z_end = std::min(z_begin + layers, view.depth());
+			mesh_range(view, readers[worker], scratch[worker], parts[slab], z_begin, z_end,
+				   faces);
+		});
+
+		// slabs are appended in z order, giving the faces in serial order
+		for (auto &&part : parts) {
+			Output::append(result, std::move(part));
+		}
+	}
+
+	template <typename Sink, typename View>
+	void mesh(const View &view, reader_t<Type> &reader, scratch_type &scratch,
+		  typename Sink::result_type &result, int32_t z_begin, int32_t z_end,
+		  bool shell = false) const
+	{
+		if (shell) {
+			mesh_shell<Sink>(view, reader, result, z_begin, z_end);
+		} else {
+			mesh_rows<Sink>(view, reader, scratch, result, z_begin, z_end);
+		}
+	}
+
+	/// Visits only the outer layer of the chunk.
+	template <typename Sink, typename View>
+	void mesh_shell(const View &view, reader_t<Type> &reader,
+			typename Sink::result_type &result, int32_t z_begin, int32_t z_end) const
+	{
+		const auto dw = view.width();
+		const auto dh = view.height();
+		const auto dd = view.depth();
+
+		vector3i p;
+		for (p.z = z_begin; p.z < z_end; ++p.z) {
+			for (p.y = 0; p.y < dh; ++p.y) {
+				const bool inner = p.z > 0 && p.z < dd - 1 && p.y > 0 && p.y < dh - 1;
+				const auto step = inner ? std::max(dw - 1, 1) : 1;
+				for (p.x = 0; p.x < dw; p.x += step) {
+					mesh_voxel<Sink>(view, reader, result, p);
 				}
 			}
+		}
+	}
 
-			return false;
+	/// Reads the visibility and culled faces of the voxels once into padded
+	/// layers of bytes and finds the visible faces a row at a time, see
+	/// weaver::internal::face_row_kernel. The faces come out in the order of
+	/// meshing voxel by voxel.
+	template <typename Sink, typename View>
+	void mesh_rows(const View &view, reader_t<Type> &reader, scratch_type &scratch,
+		       typename Sink::result_type &result, int32_t z_begin, int32_t z_end) const
+	{
+		static constexpr auto face_count = static_cast<size_t>(voxel_face::_count);
+
+		const auto dw = view.width();
+		const auto dh = view.height();
+		const size_t bw = dw + 2;
+		const size_t layer_size = bw * (dh + 2);
+
+		auto &&cull_masks = scratch.cull_masks;
+		cull_masks.clear();
+
+		auto &&layers = scratch.layers;
+		layers.resize(layer_size * 3);
+		auto fill = [&](uint8_t *layer, int32_t z) {
+			for (auto y = -1; y <= dh; ++y) {
+				auto row = layer + (y + 1) * bw + 1;
+				for (auto x = -1; x <= dw; ++x) {
+					auto c = view.at(x, y, z);
+					row[x] = c != nullptr && reader.visible(*c)
+							 ? weaver::internal::visible_bit | cull_masks(reader, *c)
+							 : 0;
+				}
+			}
 		};
 
-		vertex vert;
-		auto volume = volume_begin + bh * bw;
-		for (vert.z = 1; vert.z < bd - 1; ++vert.z) {
-			for (vert.y = 0; vert.y < bh; ++vert.y) {
-				for (vert.x = 0; vert.x < bw; ++vert.x, ++volume) {
-					const bool in_bounds = is_in_bounds(vert);
-					if (!in_bounds) {
-						continue;
-					}
+		auto bottom = layers.data();
+		auto center = bottom + layer_size;
+		auto top = center + layer_size;
+		fill(bottom, z_begin - 1);
+		fill(center, z_begin);
+
+		const auto kernel = weaver::internal::face_row();
+		auto &&faces = scratch.faces;
+		faces.resize(dw);
+
+		vector3i p;
+		for (p.z = z_begin; p.z < z_end; ++p.z) {
+			fill(top, p.z + 1);
 
-					auto state = volume_check(volume);
-					if (!state) {
+			for (p.y = 0; p.y < dh; ++p.y) {
+				const auto row = (p.y + 1) * bw + 1;
+				kernel(center + row, center + row + bw, center + row - bw, top + row,
+				       bottom + row, faces.data(), dw);
+
+				for (p.x = 0; p.x < dw; ++p.x) {
+					const auto visible = faces[p.x];
+					if (visible == 0) {
 						continue;
 					}
 
-					auto &&[nb, n, ni, cull] = find_boundries(
-						vert, volume_begin, volume_check, check_neighbor);
-
+					auto volume = view.at(p);
 					auto type_id = reader(*volume);
-					static constexpr auto size =
-						static_cast<size_t>(voxel_face::_count);
-					for (auto d = 0; d < size; ++d) {
-						if (state == n[d] && cull[d]) {
-							// there hasn't been a change in state in this direction
-							continue;
+					for (size_t d = 0; d < face_count; ++d) {
+						if (visible & (1 << d)) {
+							add_quad<Sink>(static_cast<int32_t>(d), p, result,
+								       type_id, volume, reader);
 						}
-
-						static const vertex remove_border{ 1.0, 1.0, 1.0 };
-
-						add_quad(d, state, vert - remove_border, quads,
-							 type_id, volume, reader);
 					}
 				}
 			}
-		}
 
-		return result;
+			std::swap(bottom, center);
+			std::swap(center, top);
+		}
 	}
 
-	template <typename Iter, typename T>
-	auto add_quad(int32_t direction, bool state, const vertex &vert, std::vector<quad> &quads,
-		      weaver::voxel_id_t type_id, Iter current_vox, reader_t<T> &reader) const
+	template <typename Sink, typename View>
+	void mesh_voxel(const View &view, reader_t<Type> &reader,
+			typename Sink::result_type &result, const vector3i &p) const
 	{
-		auto faces = cube_faces;
 		static constexpr auto size = static_cast<size_t>(voxel_face::_count);
-		auto d = direction;
-		auto dir = static_cast<voxel_face>(d);
-		auto voxel_defintion = reader(*current_vox, dir);
 
-		auto base_face = faces[d];
-		base_face.normal.normalize_quick();
-		base_face.type_id = type_id;
+		auto volume = view.at(p);
+		if (volume == nullptr || !reader.visible(*volume)) {
+			return;
+		}
 
-		for (auto &&def : voxel_defintion) {
-			auto face = base_face;
-			face.material_id = def.material;
+		auto type_id = reader(*volume);
+		for (size_t d = 0; d < size; ++d) {
+			auto neighbor = view.at(p + face_offsets[d]);
+			if (neighbor != nullptr && reader.visible(*neighbor) &&
+			    weaver::face_culls(reader, *neighbor, static_cast<voxel_face>((d + 3) % size))) {
+				// the neighbour hides this face
+				continue;
+			}
 
-			std::array<vector2d, 2> uv_space { };
-			uv_space[0] = weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_min); // bottom left
-			uv_space[1] = weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_max); // top right
+			add_quad<Sink>(static_cast<int32_t>(d), p, result, type_id, volume, reader);
+		}
+	}
 
-			face.for_each([&vert, &base_face, &uv_space, &def](auto i, auto &&p, auto &&uv) {
-				p = clamp(base_face[i], def.min, def.max);
-				p += vert + def.translate;
-				uv = weaver::lerp(uv_space[0], uv_space[1], 1 - uv);
-			});
+	template <typename Sink, typename Ptr>
+	auto add_quad(int32_t direction, const vector3i &p, typename Sink::result_type &result,
+		      weaver::voxel_id_t type_id, Ptr current_vox, reader_t<Type> &reader) const
+	{
+		auto dir = static_cast<voxel_face>(direction);
 
-			quads.emplace_back(face);
+		if constexpr (std::is_same_v<Sink, weaver::internal::face_counter>) {
+			result += weaver::count_faces(reader, *current_vox, dir);
+			return;
 		}
+
+		const vertex vert{ static_cast<weaver::decimal_t>(p.x), static_cast<weaver::decimal_t>(p.y),
+				   static_cast<weaver::decimal_t>(p.z) };
+		uint32_t component{ 0 };
+		weaver::for_each_quad(reader, *current_vox, dir, type_id, vert, [&](auto &&face) {
+			Sink::emit(result, face, weaver::face_info{ p, dir, component++ });
+		});
 	}
+};
+
+/// culling for chunks of Width * Height * Depth voxels, the dimensions being
+/// constants lets the compiler fold the strides and bounds of the meshing
+/// loops. Use culling for volumes of other sizes.
+template <typename Type, size_t Width, size_t Height, size_t Depth,
+	  typename Output = quad_output>
+class WEAVER_API fixed_culling : private culling<Type, Output> {
+	using base = culling<Type, Output>;
+	template <typename T> using reader_t = weaver::voxel_reader<T>;
+
+    public:
+	using result_type = typename base::result_type;
+	using scratch_type = typename base::scratch_type;
 
-	auto calc_index(const vertex &vert) const
+	template <typename Iter>
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
 	{
-		vector3i i{ vert };
-		return i.z * (width + 2) * (height + 2) + i.y * (width + 2) + i.x;
-	};
+		scratch_type scratch;
+		return eval(volume_begin, volume_end, std::move(reader), scratch);
+	}
 
-	template <typename Iter, typename VolumeCheck, typename CullingCheck>
-	auto find_boundries(const vertex &vert, Iter volume, VolumeCheck &&volume_check,
-			    CullingCheck &&cull_check) const
+	template <typename Iter>
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader,
+			 scratch_type &scratch) const
 	{
-		static constexpr auto size = static_cast<size_t>(voxel_face::_count);
-		std::array<vector3d, size> nc{
-			vert + vertex{ 1.0 }, // Right
-			vert + vertex{ 0.0, 1.0 }, // Back
-			vert + vertex{ 0.0, 0.0, 1.0 }, // Top
-			vert + vertex{ -1.0 }, // Left
-			vert + vertex{ 0.0, -1.0 }, // Front
-			vert + vertex{ 0.0, 0.0, -1.0 }, // Bottom
-		};
-		std::array<int32_t, size> ni{};
-		std::array<bool, size> nb{};
-		std::array<bool, size> n{};
-		std::array<bool, size> cull_n{};
-
-		for (auto i = 0; i < ni.size(); ++i) {
-			ni[i] = calc_index(nc[i]);
-			nb[i] = is_in_bounds(nc[i]);
-			n[i] = volume_check(volume + ni[i]);
-
-			voxel_face face = static_cast<voxel_face>((i + 3) % size);
-			cull_n[i] = n[i] && cull_check(volume + ni[i], face);
+		if (add_border) {
+			return eval(weaver::fixed_volume_view<Iter, Width, Height, Depth>{ volume_begin,
+											  volume_end },
+				    reader, scratch);
+		} else {
+			return eval(weaver::fixed_padded_volume_view<Iter, Width, Height, Depth>{
+					    volume_begin, volume_end },
+				    reader, scratch);
 		}
+	}
+
+	/// See culling::eval with neighbours.
+	template <typename Iter>
+	weaver::neighbor_mesh<result_type> eval(Iter volume_begin, Iter volume_end,
+					  const weaver::chunk_neighbors<Iter> &neighbors,
+					  reader_t<Type> reader = {}) const
+	{
+		weaver::neighbor_view<Iter> view{ volume_begin, volume_end, width,
+						  height, depth, neighbors };
+		return { eval(view, reader), view.planes() };
+	}
 
-		return std::make_tuple(nb, n, ni, cull_n);
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader = {}) const
+	{
+		return base::eval(view, std::move(reader));
 	}
 
-	auto is_in_bounds(const vertex &v) const
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader, scratch_type &scratch) const
 	{
-		return (1.0 <= v.x && v.x <= static_cast<int32_t>(width)) &&
-		       (1.0 <= v.y && v.y <= static_cast<int32_t>(height)) &&
-		       (1.0 <= v.z && v.z <= static_cast<int32_t>(depth));
+		return base::eval(view, std::move(reader), scratch);
 	}
+
+	static constexpr size_t width{ Width };
+	static constexpr size_t height{ Height };
+	static constexpr size_t depth{ Depth };
+	using base::add_border;
+	using base::indexed;
+	using base::reserve_faces;
+	using base::count_faces;
+	using base::pool;
+	using base::slab_depth;
 };
 } // namespace tc
 
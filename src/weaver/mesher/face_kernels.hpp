@@ -0,0 +1,198 @@
+#ifndef WEAVER_MESHER_FACE_KERNELS_HPP
+#define WEAVER_MESHER_FACE_KERNELS_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include <cstddef>
+#include <cstdint>
+
+#if WEAVER_SIMD && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#	define WEAVER_SIMD_X86 1
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	endif
+#	include <immintrin.h>
+#	if defined(__GNUC__) || defined(__clang__)
+#		define WEAVER_TARGET(isa) __attribute__((target(isa)))
+#	else
+#		define WEAVER_TARGET(isa)
+#	endif
+#else
+#	define WEAVER_SIMD_X86 0
+#endif
+
+namespace tc
+{
+namespace weaver
+{
+namespace internal
+{
+	/// Voxels are given to the kernels as one byte each, bits 0-5 are set for the
+	/// faces hiding the face of the neighbour they touch (see face_culls) and
+	/// bit 6 when the voxel is visible.
+	static constexpr uint8_t visible_bit = 0x40;
+
+	/// Computes the visible faces of count voxels in a row, bit d of out[x] is set
+	/// when face d of voxel x is visible. center points to the first voxel of
+	/// the row, center[-1] and center[count] are the voxels left and right of it.
+	/// back, front, top and bottom are the rows at +y, -y, +z and -z.
+	using face_row_kernel = void (*)(const uint8_t *center, const uint8_t *back,
+					 const uint8_t *front, const uint8_t *top,
+					 const uint8_t *bottom, uint8_t *out, size_t count);
+
+	static void face_row_scalar(const uint8_t *center, const uint8_t *back, const uint8_t *front,
+				    const uint8_t *top, const uint8_t *bottom, uint8_t *out,
+				    size_t count)
+	{
+		for (size_t x = 0; x < count; ++x) {
+			// a face is hidden when its neighbour hides the opposite face
+			const uint32_t hidden = ((center[x + 1] >> 3) & 1) | ((back[x] >> 4) & 1) << 1 |
+						((top[x] >> 5) & 1) << 2 | (center[x - 1] & 1) << 3 |
+						((front[x] >> 1) & 1) << 4 | ((bottom[x] >> 2) & 1) << 5;
+			out[x] = (center[x] & visible_bit) ? static_cast<uint8_t>(~hidden & 0x3f) : 0;
+		}
+	}
+
+#if WEAVER_SIMD_X86
+	// lambdas don't inherit the target of their function, hence the helpers
+
+	WEAVER_TARGET("sse2")
+	static inline __m128i load_sse2(const uint8_t *p)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+	}
+
+	/// Face bit of the neighbour moved to the face bit of the voxel.
+	WEAVER_TARGET("sse2")
+	static inline __m128i hides_sse2(__m128i v, int neighbour_face, int face)
+	{
+		const auto bit = _mm_set1_epi8(static_cast<char>(1 << neighbour_face));
+		const auto set = _mm_cmpeq_epi8(_mm_and_si128(v, bit), bit);
+		return _mm_and_si128(set, _mm_set1_epi8(static_cast<char>(1 << face)));
+	}
+
+	WEAVER_TARGET("sse2")
+	static void face_row_sse2(const uint8_t *center, const uint8_t *back, const uint8_t *front,
+				  const uint8_t *top, const uint8_t *bottom, uint8_t *out, size_t count)
+	{
+		const auto visible = _mm_set1_epi8(static_cast<char>(visible_bit));
+		const auto faces = _mm_set1_epi8(0x3f);
+
+		size_t x{ 0 };
+		for (; x + 16 <= count; x += 16) {
+			auto hidden = _mm_or_si128(hides_sse2(load_sse2(center + x + 1), 3, 0),
+						   hides_sse2(load_sse2(back + x), 4, 1));
+			hidden = _mm_or_si128(hidden, hides_sse2(load_sse2(top + x), 5, 2));
+			hidden = _mm_or_si128(hidden, hides_sse2(load_sse2(center + x - 1), 0, 3));
+			hidden = _mm_or_si128(hidden, hides_sse2(load_sse2(front + x), 1, 4));
+			hidden = _mm_or_si128(hidden, hides_sse2(load_sse2(bottom + x), 2, 5));
+
+			const auto c = load_sse2(center + x);
+			const auto shown = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(c, visible), visible),
+							 faces);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + x),
+					 _mm_andnot_si128(hidden, shown));
+		}
+
+		face_row_scalar(center + x, back + x, front + x, top + x, bottom + x, out + x,
+				count - x);
+	}
+
+	WEAVER_TARGET("avx2")
+	static inline __m256i load_avx2(const uint8_t *p)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+	}
+
+	WEAVER_TARGET("avx2")
+	static inline __m256i hides_avx2(__m256i v, int neighbour_face, int face)
+	{
+		const auto bit = _mm256_set1_epi8(static_cast<char>(1 << neighbour_face));
+		const auto set = _mm256_cmpeq_epi8(_mm256_and_si256(v, bit), bit);
+		return _mm256_and_si256(set, _mm256_set1_epi8(static_cast<char>(1 << face)));
+	}
+
+	WEAVER_TARGET("avx2")
+	static void face_row_avx2(const uint8_t *center, const uint8_t *back, const uint8_t *front,
+				  const uint8_t *top, const uint8_t *bottom, uint8_t *out, size_t count)
+	{
+		const auto visible = _mm256_set1_epi8(static_cast<char>(visible_bit));
+		const auto faces = _mm256_set1_epi8(0x3f);
+
+		size_t x{ 0 };
+		for (; x + 32 <= count; x += 32) {
+			auto hidden = _mm256_or_si256(hides_avx2(load_avx2(center + x + 1), 3, 0),
+						      hides_avx2(load_avx2(back + x), 4, 1));
+			hidden = _mm256_or_si256(hidden, hides_avx2(load_avx2(top + x), 5, 2));
+			hidden = _mm256_or_si256(hidden, hides_avx2(load_avx2(center + x - 1), 0, 3));
+			hidden = _mm256_or_si256(hidden, hides_avx2(load_avx2(front + x), 1, 4));
+			hidden = _mm256_or_si256(hidden, hides_avx2(load_avx2(bottom + x), 2, 5));
+
+			const auto c = load_avx2(center + x);
+			const auto shown = _mm256_and_si256(
+				_mm256_cmpeq_epi8(_mm256_and_si256(c, visible), visible), faces);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x),
+					    _mm256_andnot_si256(hidden, shown));
+		}
+
+		face_row_sse2(center + x, back + x, front + x, top + x, bottom + x, out + x,
+			      count - x);
+	}
+
+	static bool has_avx2()
+	{
+#	if defined(_MSC_VER) && !defined(__clang__)
+		int info[4]{};
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#	else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#	endif
+	}
+
+	static bool has_sse2()
+	{
+#	if defined(__x86_64__) || defined(_M_X64)
+		return true;
+#	elif defined(_MSC_VER) && !defined(__clang__)
+		int info[4]{};
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+#	else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("sse2");
+#	endif
+	}
+#endif
+
+	/// Picks the widest kernel the cpu supports, once per process.
+	static face_row_kernel face_row()
+	{
+		static const face_row_kernel kernel = [] {
+#if WEAVER_SIMD_X86
+			if (has_avx2()) {
+				return &face_row_avx2;
+			}
+
+			if (has_sse2()) {
+				return &face_row_sse2;
+			}
+#endif
+			return &face_row_scalar;
+		}();
+
+		return kernel;
+	}
+} // namespace internal
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_FACE_KERNELS_HPP
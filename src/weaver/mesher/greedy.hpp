@@ -0,0 +1,311 @@
+#ifndef WEAVER_MESHER_GREEDY_HPP
+#define WEAVER_MESHER_GREEDY_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "fwd.hpp"
+#include "voxel_reader.hpp"
+#include "mesher_result.hpp"
+#include "welder.hpp"
+#include "cube_def.hpp"
+#include "volume_view.hpp"
+#include <array>
+#include <vector>
+#include "../core/algorithm.hpp"
+#include "../core/voxel_face.hpp"
+
+namespace tc
+{
+/// Culling mesher that merges coplanar, adjacent faces sharing the same type,
+/// face definitions (material, uv and cull rules) into larger quads.
+/// The uvs of a merged quad run from 0 to its size in voxels, a 3x2 quad
+/// ranges over [0, 3] x [0, 2] and is meant to be sampled with a repeating
+/// wrap mode. Only faces using the whole [0, 1] uv rect are merged, faces
+/// with a partial rect, e.g. an atlas tile, are kept one per voxel so their
+/// uvs never leave the rect.
+template <typename Type> class WEAVER_API greedy {
+	template <typename T> using reader_t = weaver::voxel_reader<T>;
+
+	struct face_cell {
+		bool used{ false };
+		bool mergeable{ false };
+		weaver::voxel_id_t type_id{ weaver::unset_voxel_id };
+		std::vector<weaver::voxel_face_result> defs;
+	};
+
+	static constexpr std::array<double vector3d::*, 3> def_axes{ &vector3d::x, &vector3d::y,
+								       &vector3d::z };
+	static constexpr std::array<weaver::decimal_t vertex::*, 3> axes{ &vertex::x, &vertex::y,
+									  &vertex::z };
+
+    public:
+	using result_type = mesher_result;
+
+	template <typename Iter>
+	mesher_result eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
+	{
+		if (add_border) {
+			return eval(weaver::volume_view<Iter>{ volume_begin, volume_end, width, height,
+							       depth },
+				    reader);
+		} else {
+			return eval(weaver::padded_volume_view<Iter>{ volume_begin, volume_end, width,
+								      height, depth },
+				    reader);
+		}
+	}
+
+	/// Meshes the chunk culling its boundary faces against the given neighbours,
+	/// see weaver::neighbor_view. add_border is ignored.
+	template <typename Iter>
+	weaver::neighbor_mesh<mesher_result> eval(Iter volume_begin, Iter volume_end,
+					  const weaver::chunk_neighbors<Iter> &neighbors,
+					  reader_t<Type> reader = {}) const
+	{
+		weaver::neighbor_view<Iter> view{ volume_begin, volume_end, width,
+						  height, depth, neighbors };
+		return { eval(view, reader), view.planes() };
+	}
+
+	/// Meshes the view's chunk, width, height, depth and add_border are taken from the view.
+	template <typename View>
+	mesher_result eval(const View &view, reader_t<Type> reader = {}) const
+	{
+		return work(view, reader);
+	}
+
+	size_t width{ 0 };
+	size_t height{ 0 };
+	size_t depth{ 0 };
+	bool add_border{ false };
+	/// Output welded, indexed vertices instead of quads, see weaver::weld_quads.
+	bool indexed{ false };
+
+    private:
+	template <typename View>
+	mesher_result work(const View &view, reader_t<Type> &reader) const
+	{
+		const std::array<int32_t, 3> dims{ view.width(), view.height(), view.depth() };
+
+		mesher_result result;
+
+		auto volume_check = [&reader](auto c) {
+			if (c == nullptr) {
+				return false;
+			}
+
+			return reader.visible(*c);
+		};
+
+		auto check_neighbor = [&reader](auto c, auto dir) {
+			return weaver::face_culls(reader, *c, dir);
+		};
+
+		std::vector<face_cell> mask;
+		static constexpr auto size = static_cast<int32_t>(voxel_face::_count);
+		for (auto d = 0; d < size; ++d) {
+			// right, back and top share their axis with left, front and bottom
+			const auto axis = d % 3;
+			const auto u = (axis + 1) % 3;
+			const auto v = (axis + 2) % 3;
+			const auto dir = static_cast<voxel_face>(d);
+			const auto opposite = static_cast<voxel_face>((d + 3) % size);
+			const auto offset = d < 3 ? 1 : -1;
+
+			mask.resize(dims[u] * dims[v]);
+
+			std::array<int32_t, 3> pos{};
+			for (pos[axis] = 0; pos[axis] < dims[axis]; ++pos[axis]) {
+				for (pos[v] = 0; pos[v] < dims[v]; ++pos[v]) {
+					for (pos[u] = 0; pos[u] < dims[u]; ++pos[u]) {
+						auto &&cell = mask[pos[v] * dims[u] + pos[u]];
+						cell.used = false;
+						cell.defs.clear();
+
+						auto volume = view.at(pos[0], pos[1], pos[2]);
+						if (!volume_check(volume)) {
+							continue;
+						}
+
+						auto next = pos;
+						next[axis] += offset;
+						auto neighbor = view.at(next[0], next[1], next[2]);
+						if (volume_check(neighbor) &&
+						    check_neighbor(neighbor, opposite)) {
+							// face is hidden by the neighbor
+							continue;
+						}
+
+						cell.used = true;
+						cell.type_id = reader(*volume);
+						weaver::for_each_face(reader, *volume, dir, [&cell](auto &&def) {
+							cell.defs.emplace_back(def);
+						});
+						cell.mergeable = is_mergeable(cell.defs, u, v);
+					}
+				}
+
+				merge_slice(d, pos[axis], dims, mask, result.quads);
+			}
+		}
+
+		if (indexed) {
+			weaver::weld_quads(result);
+		}
+
+		return result;
+	}
+
+	/// Faces can only be merged when every part of them covers the whole
+	/// voxel face, otherwise the merged quad would fill gaps between voxels,
+	/// and uses the whole uv rect, otherwise repeating it would sample outside.
+	static bool is_mergeable(const std::vector<weaver::voxel_face_result> &defs, int32_t u,
+				 int32_t v)
+	{
+		for (auto &&def : defs) {
+			for (auto a : { u, v }) {
+				if (def.min.*def_axes[a] > 0.0 || def.max.*def_axes[a] < 1.0) {
+					return false;
+				}
+			}
+
+			if (def.uv_min.x != 0.0 || def.uv_min.y != 0.0 || def.uv_max.x != 1.0 ||
+			    def.uv_max.y != 1.0) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static bool is_same(const face_cell &a, const face_cell &b)
+	{
+		if (!b.used || !b.mergeable || a.type_id != b.type_id ||
+		    a.defs.size() != b.defs.size()) {
+			return false;
+		}
+
+		for (size_t i = 0; i < a.defs.size(); ++i) {
+			auto &&l = a.defs[i];
+			auto &&r = b.defs[i];
+			if (l.material != r.material || l.cull != r.cull ||
+			    !is_equal(l.min, r.min) || !is_equal(l.max, r.max) ||
+			    !is_equal(l.translate, r.translate) || l.uv_min.x != r.uv_min.x ||
+			    l.uv_min.y != r.uv_min.y || l.uv_max.x != r.uv_max.x ||
+			    l.uv_max.y != r.uv_max.y) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static bool is_equal(const vector3d &a, const vector3d &b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	void merge_slice(int32_t direction, int32_t layer, const std::array<int32_t, 3> &dims,
+			 std::vector<face_cell> &mask, std::vector<quad> &quads) const
+	{
+		const auto axis = direction % 3;
+		const auto u = (axis + 1) % 3;
+		const auto v = (axis + 2) % 3;
+		const auto du = dims[u];
+		const auto dv = dims[v];
+
+		for (auto j = 0; j < dv; ++j) {
+			for (auto i = 0; i < du;) {
+				auto &&cell = mask[j * du + i];
+				if (!cell.used) {
+					++i;
+					continue;
+				}
+
+				int32_t w{ 1 };
+				int32_t h{ 1 };
+				if (cell.mergeable) {
+					while (i + w < du && is_same(cell, mask[j * du + i + w])) {
+						++w;
+					}
+
+					for (bool grow = true; grow && j + h < dv;) {
+						for (auto k = 0; k < w; ++k) {
+							if (!is_same(cell, mask[(j + h) * du + i + k])) {
+								grow = false;
+								break;
+							}
+						}
+
+						if (grow) {
+							++h;
+						}
+					}
+				}
+
+				vertex origin;
+				origin.*axes[axis] = layer;
+				origin.*axes[u] = i;
+				origin.*axes[v] = j;
+
+				vertex extent{ 1.0, 1.0, 1.0 };
+				extent.*axes[u] = w;
+				extent.*axes[v] = h;
+
+				add_quad(direction, origin, extent, cell, quads);
+
+				for (auto y = 0; y < h; ++y) {
+					for (auto x = 0; x < w; ++x) {
+						mask[(j + y) * du + i + x].used = false;
+					}
+				}
+
+				i += w;
+			}
+		}
+	}
+
+	auto add_quad(int32_t direction, const vertex &vert, const vertex &extent,
+		      const face_cell &cell, std::vector<quad> &quads) const
+	{
+		auto faces = cube_faces;
+		auto d = direction;
+
+		auto base_face = faces[d];
+		base_face.normal.normalize_quick();
+		base_face.type_id = cell.type_id;
+
+		// The uv axes follow the quad edges, 0 -> 1 is the first and 1 -> 2 the second.
+		auto edge_extent = [&base_face, &extent](int32_t from, int32_t to) {
+			auto e = base_face[to] - base_face[from];
+			for (auto a = 0; a < 3; ++a) {
+				if (e.*axes[a] != 0.0) {
+					return extent.*axes[a];
+				}
+			}
+			return weaver::decimal_t{ 1 };
+		};
+		const quad::uv_t uv_extent{ edge_extent(0, 1), edge_extent(1, 2) };
+
+		for (auto &&def : cell.defs) {
+			auto face = base_face;
+			face.material_id = def.material;
+
+			std::array<quad::uv_t, 2> uv_space{};
+			uv_space[0] = weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_min); // bottom left
+			uv_space[1] = weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_max); // top right
+
+			face.for_each([&](auto i, auto &&p, auto &&uv) {
+				p = clamp(base_face[i], vertex{ def.min }, vertex{ def.max });
+				p *= extent;
+				p += vert + def.translate;
+				uv = weaver::lerp(uv_space[0], uv_space[1], (1 - uv) * uv_extent);
+			});
+
+			quads.emplace_back(face);
+		}
+	}
+};
+} // namespace tc
+
+#endif // WEAVER_MESHER_GREEDY_HPP
@@ -0,0 +1,248 @@
+#ifndef WEAVER_MESHER_INCREMENTAL_HPP
+#define WEAVER_MESHER_INCREMENTAL_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/quad.hpp"
+#include "../core/vector3.hpp"
+#include "fwd.hpp"
+#include "voxel_reader.hpp"
+#include "mesher_result.hpp"
+#include "output.hpp"
+#include "culling.hpp"
+#include "cube_def.hpp"
+#include "volume_view.hpp"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+namespace internal
+{
+	static constexpr uint32_t no_face = UINT32_MAX;
+
+	/// Quads of a chunk and the voxel owning each of them. The quads of a voxel
+	/// form a list through next, starting at its head.
+	struct face_spans {
+		void clear(size_t voxels)
+		{
+			result = {};
+			owner.clear();
+			next.clear();
+			head.assign(voxels, no_face);
+		}
+
+		void add(uint32_t voxel, const quad &face)
+		{
+			const auto index = static_cast<uint32_t>(result.quads.size());
+			result.quads.emplace_back(face);
+			owner.emplace_back(voxel);
+			next.emplace_back(head[voxel]);
+			head[voxel] = index;
+		}
+
+		void remove(uint32_t voxel)
+		{
+			while (head[voxel] != no_face) {
+				const auto index = head[voxel];
+				head[voxel] = next[index];
+				erase(index);
+			}
+		}
+
+		size_t faces(uint32_t voxel) const
+		{
+			size_t count{ 0 };
+			for (auto i = head[voxel]; i != no_face; i = next[i]) {
+				++count;
+			}
+			return count;
+		}
+
+		mesher_result result;
+		std::vector<uint32_t> owner;
+		std::vector<uint32_t> next;
+		std::vector<uint32_t> head;
+		/// Index of the voxel emitted faces belong to.
+		uint32_t voxel{ 0 };
+
+	    private:
+		/// Moves the last quad into the hole so the buffer stays packed.
+		void erase(uint32_t index)
+		{
+			const auto last = static_cast<uint32_t>(result.quads.size() - 1);
+			if (index != last) {
+				result.quads[index] = std::move(result.quads[last]);
+				owner[index] = owner[last];
+				next[index] = next[last];
+
+				auto *link = &head[owner[index]];
+				while (*link != last) {
+					link = &next[*link];
+				}
+				*link = index;
+			}
+
+			result.quads.pop_back();
+			owner.pop_back();
+			next.pop_back();
+		}
+	};
+
+	/// Sink adding the faces of the voxel being meshed to its list.
+	struct face_span_output {
+		using result_type = face_spans;
+
+		static void reserve(result_type &result, size_t faces)
+		{
+			result.result.quads.reserve(faces);
+		}
+
+		static void emit(result_type &result, const quad &face, const face_info &)
+		{
+			result.add(result.voxel, face);
+		}
+	};
+} // namespace internal
+} // namespace weaver
+
+/// Stateful culling mesher for a chunk that is edited after meshing.
+/// The quads of every voxel are tracked so edits only regenerate the faces of
+/// the changed voxels and their six neighbours, patching the quad buffer in
+/// place. Quads of untouched voxels keep their values but not necessarily
+/// their position in the buffer. The border of the chunk is empty, as with
+/// add_border.
+/// Faces are queried for every voxel, the result matches tc::culling.
+template <typename Type> class WEAVER_API incremental {
+	template <typename T> using reader_t = weaver::voxel_reader<T>;
+	using view_t = weaver::volume_view<const Type *>;
+
+    public:
+	using result_type = mesher_result;
+
+	/// Meshes the whole chunk of width * height * depth voxels. The voxels are
+	/// read again by update, so they have to stay alive and in place.
+	const mesher_result &eval(const Type *voxels, reader_t<Type> reader = {})
+	{
+		voxels_ = voxels;
+		reader_ = std::move(reader);
+
+		const auto count = width * height * depth;
+		spans_.clear(count);
+		dirty_.assign(count, false);
+		pending_.clear();
+
+		const auto view = make_view();
+		for (int32_t z = 0; z < view.depth(); ++z) {
+			for (int32_t y = 0; y < view.height(); ++y) {
+				for (int32_t x = 0; x < view.width(); ++x) {
+					mesh_voxel(view, vector3i{ x, y, z });
+				}
+			}
+		}
+
+		return spans_.result;
+	}
+
+	/// Marks a voxel as changed, marks are collected until the next update.
+	void mark(const vector3i &position)
+	{
+		mark_voxel(position);
+
+		for (auto &&offset : face_offsets) {
+			mark_voxel(position + offset);
+		}
+	}
+
+	template <typename Range> void mark(const Range &positions)
+	{
+		for (auto &&position : positions) {
+			mark(position);
+		}
+	}
+
+	/// Regenerates the faces of all voxels marked since the last update.
+	const mesher_result &update()
+	{
+		for (auto index : pending_) {
+			spans_.remove(index);
+		}
+
+		const auto view = make_view();
+		for (auto index : pending_) {
+			dirty_[index] = false;
+			mesh_voxel(view, position(index));
+		}
+		pending_.clear();
+
+		return spans_.result;
+	}
+
+	const mesher_result &result() const
+	{
+		return spans_.result;
+	}
+
+	/// Number of quads the voxel currently owns.
+	size_t faces(const vector3i &position) const
+	{
+		return spans_.faces(index(position));
+	}
+
+	size_t width{ 0 };
+	size_t height{ 0 };
+	size_t depth{ 0 };
+
+    private:
+	view_t make_view() const
+	{
+		return view_t{ voxels_, voxels_ + width * height * depth, width, height, depth };
+	}
+
+	void mark_voxel(const vector3i &p)
+	{
+		if (static_cast<size_t>(p.x) >= width || static_cast<size_t>(p.y) >= height ||
+		    static_cast<size_t>(p.z) >= depth) {
+			return;
+		}
+
+		const auto i = index(p);
+		if (!dirty_[i]) {
+			dirty_[i] = true;
+			pending_.emplace_back(i);
+		}
+	}
+
+	void mesh_voxel(const view_t &view, const vector3i &p)
+	{
+		spans_.voxel = index(p);
+		mesher_.template mesh_voxel<weaver::internal::face_span_output>(view, reader_, spans_, p);
+	}
+
+	uint32_t index(const vector3i &p) const
+	{
+		return static_cast<uint32_t>((p.z * height + p.y) * width + p.x);
+	}
+
+	vector3i position(uint32_t index) const
+	{
+		const auto x = index % width;
+		const auto y = index / width % height;
+		const auto z = index / width / height;
+		return vector3i{ static_cast<int32_t>(x), static_cast<int32_t>(y),
+				 static_cast<int32_t>(z) };
+	}
+
+	culling<Type, weaver::internal::face_span_output> mesher_;
+	const Type *voxels_{ nullptr };
+	reader_t<Type> reader_;
+	weaver::internal::face_spans spans_;
+	std::vector<bool> dirty_;
+	std::vector<uint32_t> pending_;
+};
+} // namespace tc
+
+#endif // WEAVER_MESHER_INCREMENTAL_HPP
@@ -0,0 +1,218 @@
+#ifndef WEAVER_MESHER_MESH_CACHE_HPP
+#define WEAVER_MESHER_MESH_CACHE_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/hash.hpp"
+#include "fwd.hpp"
+#include "voxel_reader.hpp"
+#include "mesher_result.hpp"
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+/// Least recently used cache of meshes keyed by the content of their chunk,
+/// for worlds repeating the same chunks (all air, all stone, prefabs).
+/// The key hashes the type id of every visible voxel, the mesher's dimensions
+/// and a caller chosen reader id, so the reader has to give voxels with the
+/// same type id the same faces. Use one cache per mesher configuration.
+/// Every entry keeps the ids it was made from, run length encoded, and a hit
+/// is only taken when they match, so chunks with colliding hashes never share
+/// a mesh.
+/// All functions are thread safe, meshing happens outside of the lock.
+template <typename Result = mesher_result> class WEAVER_API mesh_cache {
+	/// What a mesh is made from, everything the key hashes.
+	struct content {
+		uint64_t reader_id{ 0 };
+		std::array<uint64_t, 3> dims{};
+		bool add_border{ false };
+		/// Runs of equal type ids, unset_voxel_id for invisible voxels.
+		std::vector<std::pair<voxel_id_t, uint32_t>> runs;
+
+		bool operator==(const content &other) const
+		{
+			return reader_id == other.reader_id && dims == other.dims &&
+			       add_border == other.add_border && runs == other.runs;
+		}
+	};
+
+	struct entry {
+		uint64_t key{ 0 };
+		content source;
+		std::shared_ptr<const Result> mesh;
+	};
+
+    public:
+	using pointer = std::shared_ptr<const Result>;
+
+	explicit mesh_cache(size_t capacity) : capacity_{ capacity }
+	{
+	}
+
+	/// Returns the cached mesh of an identical chunk or meshes and caches it.
+	template <typename Mesher, typename Iter, typename Type>
+	pointer eval(const Mesher &mesher, Iter volume_begin, Iter volume_end,
+		     voxel_reader<Type> reader, uint64_t reader_id = 0)
+	{
+		auto source = read(mesher, volume_begin, volume_end, reader, reader_id);
+		const auto key = hash(source);
+		if (auto mesh = find(key, source)) {
+			return mesh;
+		}
+
+		auto mesh = std::make_shared<const Result>(
+			mesher.eval(volume_begin, volume_end, reader));
+		insert(key, std::move(source), mesh);
+		return mesh;
+	}
+
+	template <typename Mesher, typename Iter>
+	pointer eval(const Mesher &mesher, Iter volume_begin, Iter volume_end)
+	{
+		using voxel_t = std::remove_cv_t<std::remove_reference_t<decltype(*volume_begin)>>;
+		return eval(mesher, volume_begin, volume_end, voxel_reader<voxel_t>{});
+	}
+
+	/// Content hash used as the cache key.
+	template <typename Mesher, typename Iter, typename Type>
+	static uint64_t hash(const Mesher &mesher, Iter volume_begin, Iter volume_end,
+			     voxel_reader<Type> &reader, uint64_t reader_id = 0)
+	{
+		return hash(read(mesher, volume_begin, volume_end, reader, reader_id));
+	}
+
+	size_t hits() const
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		return hits_;
+	}
+
+	size_t misses() const
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		return misses_;
+	}
+
+	size_t size() const
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		return entries_.size();
+	}
+
+	size_t capacity() const
+	{
+		return capacity_;
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		entries_.clear();
+		index_.clear();
+	}
+
+    private:
+	template <typename Mesher, typename Iter, typename Type>
+	static content read(const Mesher &mesher, Iter volume_begin, Iter volume_end,
+			    voxel_reader<Type> &reader, uint64_t reader_id)
+	{
+		content source;
+		source.reader_id = reader_id;
+		source.dims = { static_cast<uint64_t>(mesher.width),
+				static_cast<uint64_t>(mesher.height),
+				static_cast<uint64_t>(mesher.depth) };
+		source.add_border = mesher.add_border;
+
+		for (auto it = volume_begin; it != volume_end; ++it) {
+			// invisible voxels never produce or hide faces
+			const voxel_id_t id = reader.visible(*it) ? reader(*it) : unset_voxel_id;
+			if (!source.runs.empty() && source.runs.back().first == id) {
+				++source.runs.back().second;
+			} else {
+				source.runs.emplace_back(id, 1);
+			}
+		}
+
+		return source;
+	}
+
+	static uint64_t hash(const content &source)
+	{
+		auto h = fnv1a_offset<uint64_t>;
+		h = fnv1a_append(h, source.reader_id);
+		for (auto dim : source.dims) {
+			h = fnv1a_append(h, dim);
+		}
+		h = fnv1a_append(h, source.add_border);
+
+		for (auto &&[id, count] : source.runs) {
+			for (uint32_t i = 0; i < count; ++i) {
+				h = fnv1a_append(h, id);
+			}
+		}
+
+		return h;
+	}
+
+	pointer find(uint64_t key, const content &source)
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		auto it = index_.find(key);
+		if (it == std::end(index_) || !(it->second->source == source)) {
+			++misses_;
+			return nullptr;
+		}
+
+		++hits_;
+		entries_.splice(std::begin(entries_), entries_, it->second);
+		return it->second->mesh;
+	}
+
+	void insert(uint64_t key, content source, pointer mesh)
+	{
+		std::lock_guard<std::mutex> guard{ lock_ };
+		if (capacity_ == 0) {
+			return;
+		}
+
+		if (auto it = index_.find(key); it != std::end(index_)) {
+			if (it->second->source == source) {
+				// another thread meshed the same chunk first
+				return;
+			}
+
+			// a chunk with a colliding hash, the newer one takes its place
+			entries_.erase(it->second);
+			index_.erase(it);
+		}
+
+		if (entries_.size() == capacity_) {
+			index_.erase(entries_.back().key);
+			entries_.pop_back();
+		}
+
+		entries_.emplace_front(entry{ key, std::move(source), std::move(mesh) });
+		index_.emplace(key, std::begin(entries_));
+	}
+
+	size_t capacity_{ 0 };
+	size_t hits_{ 0 };
+	size_t misses_{ 0 };
+	std::list<entry> entries_;
+	std::unordered_map<uint64_t, typename std::list<entry>::iterator> index_;
+	mutable std::mutex lock_;
+};
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_MESH_CACHE_HPP
@@ -2,6 +2,8 @@
 #define WEAVER_MESHER_MESHER_RESULT_HPP
 
 #include <vector>
+#include <cstdint>
+#include <string_view>
 #include "../config/config.hpp"
 #include "../core/attributes.hpp"
 #include "../core/fwd.hpp"
@@ -12,11 +14,52 @@
 
 namespace tc
 {
+	/// Index buffer using 16 bit indices while the vertex count allows it.
+	struct WEAVER_API index_buffer
+	{
+		bool is_wide() const
+		{
+			return !wide.empty();
+		}
+
+		size_t size() const
+		{
+			return is_wide() ? wide.size() : narrow.size();
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		uint32_t operator[](size_t i) const
+		{
+			return is_wide() ? wide[i] : narrow[i];
+		}
+
+		std::vector<uint16_t> narrow;
+		std::vector<uint32_t> wide;
+	};
+
+	/// Range of the index buffer drawn with one material.
+	struct WEAVER_API mesh_section
+	{
+		weaver::material_id_t material_id{ weaver::no_material_id };
+		size_t first_index{ 0 };
+		size_t index_count{ 0 };
+	};
+
 	struct WEAVER_API mesher_result
 	{
 		std::vector<vertex> vertices;
 		std::vector<quad> quads;
+
+		/// Per vertex attributes, only filled for indexed output.
+		std::vector<quad::normal_t> normals;
+		std::vector<quad::uv_t> uvs;
+		index_buffer indices;
+		std::vector<mesh_section> sections;
 	};
 }
 
-#endif // WEAVER_MESHER_MESHER_RESULT_HPP
\ No newline at end of file
+#endif // WEAVER_MESHER_MESHER_RESULT_HPP
@@ -0,0 +1,409 @@
+#ifndef WEAVER_MESHER_OUTPUT_HPP
+#define WEAVER_MESHER_OUTPUT_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/algorithm.hpp"
+#include "../core/quad.hpp"
+#include "../core/vector2.hpp"
+#include "../core/vector3.hpp"
+#include "../core/voxel_face.hpp"
+#include "mesher_result.hpp"
+#include "cube_def.hpp"
+#include "voxel_face_result.hpp"
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+/// Where a face emitted by a mesher comes from.
+struct WEAVER_API face_info {
+	/// Voxel position relative to the chunk origin.
+	vector3i position{};
+	voxel_face face{ voxel_face::right };
+	/// Index of the face result the quad was built from.
+	uint32_t component{ 0 };
+};
+} // namespace weaver
+
+/// Output policies decide what a mesher writes for every visible face.
+/// A policy provides a `result_type` and the static functions
+/// `reserve(result_type &, size_t faces)` and
+/// `emit(result_type &, const quad &, const weaver::face_info &)`, and
+/// `append(result_type &, result_type &&)` which adds the faces of a second
+/// result as if they had been emitted after the first one's.
+
+/// Default output, stores every face as a quad in a mesher_result.
+struct WEAVER_API quad_output {
+	using result_type = mesher_result;
+
+	static void reserve(result_type &result, size_t faces)
+	{
+		result.quads.reserve(faces);
+	}
+
+	static void emit(result_type &result, const quad &face, const weaver::face_info &)
+	{
+		result.quads.emplace_back(face);
+	}
+
+	static void append(result_type &result, result_type &&other)
+	{
+		if (result.quads.empty()) {
+			result.quads = std::move(other.quads);
+			return;
+		}
+
+		result.quads.insert(std::end(result.quads), std::begin(other.quads),
+				    std::end(other.quads));
+	}
+};
+
+struct WEAVER_API float_vertex {
+	base_vector3<float> position{};
+	vector2f uv{};
+	uint8_t face{ 0 };
+};
+
+/// Position in fixed point relative to the chunk origin, uv in unsigned normalized form.
+struct WEAVER_API short_vertex {
+	base_vector3<int16_t> position{};
+	base_vector2<uint16_t> uv{};
+	uint8_t face{ 0 };
+};
+
+/// Integer corner position, face and uv corner in a single 32 bit word.
+/// Bits 0-6 x, 7-13 y, 14-20 z, 21-23 face, 24 u, 25 v.
+struct WEAVER_API packed_vertex {
+	static constexpr uint32_t max_position = 127;
+
+	static constexpr packed_vertex pack(uint32_t x, uint32_t y, uint32_t z, uint32_t face,
+					    uint32_t u, uint32_t v)
+	{
+		return packed_vertex{ x | (y << 7) | (z << 14) | (face << 21) | (u << 24) | (v << 25) };
+	}
+
+	constexpr uint32_t x() const
+	{
+		return value & 0x7f;
+	}
+
+	constexpr uint32_t y() const
+	{
+		return (value >> 7) & 0x7f;
+	}
+
+	constexpr uint32_t z() const
+	{
+		return (value >> 14) & 0x7f;
+	}
+
+	constexpr voxel_face face() const
+	{
+		return static_cast<voxel_face>((value >> 21) & 0x7);
+	}
+
+	constexpr uint32_t u() const
+	{
+		return (value >> 24) & 0x1;
+	}
+
+	constexpr uint32_t v() const
+	{
+		return (value >> 25) & 0x1;
+	}
+
+	uint32_t value{ 0 };
+};
+
+/// Compact output, four vertices per face in quad corner order.
+/// The normal is implied by the face stored in every vertex.
+template <typename Vertex> struct WEAVER_API compact_mesh {
+	std::vector<Vertex> vertices;
+	/// Material of every face.
+	std::vector<weaver::material_id_t> face_materials;
+	/// Faces the vertex format cannot represent.
+	std::vector<quad> quads;
+};
+
+namespace weaver
+{
+namespace internal
+{
+	/// Sink used to count the faces a mesher would emit, meshers skip
+	/// building the quads when counting.
+	struct face_counter {
+		using result_type = size_t;
+
+		static void reserve(result_type &, size_t)
+		{
+		}
+
+		static void emit(result_type &result, const quad &, const face_info &)
+		{
+			++result;
+		}
+
+		static void append(result_type &result, result_type &&other)
+		{
+			result += other;
+		}
+	};
+
+	template <typename Vertex> struct compact_output {
+		using result_type = compact_mesh<Vertex>;
+
+		static void reserve(result_type &result, size_t faces)
+		{
+			result.vertices.reserve(faces * 4);
+			result.face_materials.reserve(faces);
+		}
+
+		static void append(result_type &result, result_type &&other)
+		{
+			result.vertices.insert(std::end(result.vertices), std::begin(other.vertices),
+					       std::end(other.vertices));
+			result.quads.insert(std::end(result.quads), std::begin(other.quads),
+					    std::end(other.quads));
+			result.face_materials.insert(std::end(result.face_materials),
+						     std::begin(other.face_materials),
+						     std::end(other.face_materials));
+		}
+	};
+} // namespace internal
+} // namespace weaver
+
+/// Float vertices, the mesher's precision is kept until the face is written.
+struct WEAVER_API float_output : weaver::internal::compact_output<float_vertex> {
+	static void emit(result_type &result, const quad &face, const weaver::face_info &info)
+	{
+		const auto dir = info.face;
+		face.for_each([&result, dir](auto, auto &&p, auto &&uv) {
+			float_vertex v;
+			v.position = base_vector3<float>{ p };
+			v.uv = vector2f{ uv };
+			v.face = static_cast<uint8_t>(dir);
+			result.vertices.emplace_back(v);
+		});
+		result.face_materials.emplace_back(face.material_id);
+	}
+};
+
+/// Fixed point vertices with Precision steps per voxel, the positions of a
+/// chunk must stay within +-32767 / Precision voxels and uvs within [0, 1].
+template <int32_t Precision = 256>
+struct WEAVER_API short_output : weaver::internal::compact_output<short_vertex> {
+	static constexpr int32_t precision = Precision;
+
+	static void emit(result_type &result, const quad &face, const weaver::face_info &info)
+	{
+		const auto dir = info.face;
+		face.for_each([&result, dir](auto, auto &&p, auto &&uv) {
+			auto fixed = [](weaver::decimal_t v) {
+				return static_cast<int16_t>(std::lround(v * Precision));
+			};
+			auto unorm = [](weaver::decimal_t v) {
+				auto unit = weaver::clamp<weaver::decimal_t>(v, 0, 1);
+				return static_cast<uint16_t>(std::lround(unit * 65535));
+			};
+
+			short_vertex v;
+			v.position = base_vector3<int16_t>{ fixed(p.x), fixed(p.y), fixed(p.z) };
+			v.uv = base_vector2<uint16_t>{ unorm(uv.x), unorm(uv.y) };
+			v.face = static_cast<uint8_t>(dir);
+			result.vertices.emplace_back(v);
+		});
+		result.face_materials.emplace_back(face.material_id);
+	}
+};
+
+/// Packed 32 bit vertices for full voxel faces, faces with corners off the
+/// integer grid or partial uv rects are kept as quads.
+struct WEAVER_API packed_output : weaver::internal::compact_output<packed_vertex> {
+	static void emit(result_type &result, const quad &face, const weaver::face_info &info)
+	{
+		const auto dir = info.face;
+		std::array<packed_vertex, 4> packed{};
+		bool representable{ true };
+		face.for_each([&](auto i, auto &&p, auto &&uv) {
+			auto on_grid = [](weaver::decimal_t v, weaver::decimal_t max) {
+				return v >= 0 && v <= max && std::floor(v) == v;
+			};
+
+			constexpr weaver::decimal_t max = packed_vertex::max_position;
+			if (!on_grid(p.x, max) || !on_grid(p.y, max) || !on_grid(p.z, max) ||
+			    !on_grid(uv.x, 1) || !on_grid(uv.y, 1)) {
+				representable = false;
+				return;
+			}
+
+			packed[i] = packed_vertex::pack(
+				static_cast<uint32_t>(p.x), static_cast<uint32_t>(p.y),
+				static_cast<uint32_t>(p.z), static_cast<uint32_t>(dir),
+				static_cast<uint32_t>(uv.x), static_cast<uint32_t>(uv.y));
+		});
+
+		if (!representable) {
+			result.quads.emplace_back(face);
+			return;
+		}
+
+		result.vertices.insert(std::end(result.vertices), std::begin(packed), std::end(packed));
+		result.face_materials.emplace_back(face.material_id);
+	}
+};
+
+/// A visible face in 8 bytes, to be expanded on the gpu with the face
+/// templates of its type (see weaver::expand_face).
+/// Bits 0-7 x, 8-15 y, 16-23 z, 24-26 face, 27-31 component, 32-63 type index.
+struct WEAVER_API face_record {
+	static constexpr uint32_t max_position = 255;
+	static constexpr uint32_t max_component = 31;
+
+	static constexpr face_record pack(uint32_t x, uint32_t y, uint32_t z, uint32_t face,
+					  uint32_t component, uint32_t type_index)
+	{
+		return face_record{ static_cast<uint64_t>(x) | (static_cast<uint64_t>(y) << 8) |
+				    (static_cast<uint64_t>(z) << 16) |
+				    (static_cast<uint64_t>(face) << 24) |
+				    (static_cast<uint64_t>(component) << 27) |
+				    (static_cast<uint64_t>(type_index) << 32) };
+	}
+
+	constexpr uint32_t x() const
+	{
+		return static_cast<uint32_t>(value & 0xff);
+	}
+
+	constexpr uint32_t y() const
+	{
+		return static_cast<uint32_t>((value >> 8) & 0xff);
+	}
+
+	constexpr uint32_t z() const
+	{
+		return static_cast<uint32_t>((value >> 16) & 0xff);
+	}
+
+	constexpr voxel_face face() const
+	{
+		return static_cast<voxel_face>((value >> 24) & 0x7);
+	}
+
+	constexpr uint32_t component() const
+	{
+		return static_cast<uint32_t>((value >> 27) & 0x1f);
+	}
+
+	constexpr uint32_t type_index() const
+	{
+		return static_cast<uint32_t>(value >> 32);
+	}
+
+	uint64_t value{ 0 };
+};
+
+struct WEAVER_API face_record_mesh {
+	std::vector<face_record> records;
+	/// Type id of every type index used by the records.
+	std::vector<weaver::voxel_id_t> types;
+	/// Type index of every type id in types.
+	std::unordered_map<weaver::voxel_id_t, uint32_t> type_indices;
+};
+
+/// One face_record per visible face, chunks must be at most 256 voxels wide
+/// and faces made of at most 32 components.
+struct WEAVER_API face_record_output {
+	using result_type = face_record_mesh;
+
+	static void reserve(result_type &result, size_t faces)
+	{
+		result.records.reserve(faces);
+	}
+
+	static void emit(result_type &result, const quad &face, const weaver::face_info &info)
+	{
+		WEAVER_ASSERT(info.component <= face_record::max_component);
+		WEAVER_ASSERT(info.position.x >= 0 && info.position.y >= 0 && info.position.z >= 0);
+		WEAVER_ASSERT(static_cast<uint32_t>(info.position.x) <= face_record::max_position &&
+			      static_cast<uint32_t>(info.position.y) <= face_record::max_position &&
+			      static_cast<uint32_t>(info.position.z) <= face_record::max_position);
+
+		result.records.emplace_back(face_record::pack(
+			static_cast<uint32_t>(info.position.x), static_cast<uint32_t>(info.position.y),
+			static_cast<uint32_t>(info.position.z), static_cast<uint32_t>(info.face),
+			info.component, type_index(result, face.type_id)));
+	}
+
+	static void append(result_type &result, result_type &&other)
+	{
+		// types are indexed in order of use, remapping keeps that order
+		std::vector<uint64_t> remap;
+		remap.reserve(other.types.size());
+		for (auto type_id : other.types) {
+			remap.emplace_back(static_cast<uint64_t>(type_index(result, type_id)) << 32);
+		}
+
+		result.records.reserve(result.records.size() + other.records.size());
+		for (auto &&record : other.records) {
+			result.records.emplace_back(face_record{ (record.value & 0xffffffff) |
+								 remap[record.type_index()] });
+		}
+	}
+
+    private:
+	static uint32_t type_index(result_type &result, weaver::voxel_id_t type_id)
+	{
+		// faces of one type mostly follow each other
+		if (!result.types.empty() && result.types.back() == type_id) {
+			return static_cast<uint32_t>(result.types.size() - 1);
+		}
+
+		auto [it, inserted] = result.type_indices.try_emplace(
+			type_id, static_cast<uint32_t>(result.types.size()));
+		if (inserted) {
+			result.types.emplace_back(type_id);
+		}
+		return it->second;
+	}
+};
+
+namespace weaver
+{
+/// Builds the quad a mesher would have emitted for the record, def is the
+/// face result at the record's component for its type and face.
+inline quad expand_face(const face_record &record, voxel_id_t type_id,
+			const voxel_face_result &def)
+{
+	auto base_face = cube_faces[static_cast<size_t>(record.face())];
+	base_face.normal.normalize_quick();
+	base_face.type_id = type_id;
+
+	auto face = base_face;
+	face.material_id = def.material;
+
+	const vertex vert{ static_cast<decimal_t>(record.x()), static_cast<decimal_t>(record.y()),
+			   static_cast<decimal_t>(record.z()) };
+
+	std::array<quad::uv_t, 2> uv_space{};
+	uv_space[0] = lerp(base_face.uv[0], base_face.uv[2], def.uv_min); // bottom left
+	uv_space[1] = lerp(base_face.uv[0], base_face.uv[2], def.uv_max); // top right
+
+	face.for_each([&vert, &base_face, &uv_space, &def](auto i, auto &&p, auto &&uv) {
+		p = clamp(base_face[i], vertex{ def.min }, vertex{ def.max });
+		p += vert + def.translate;
+		uv = lerp(uv_space[0], uv_space[1], 1 - uv);
+	});
+
+	return face;
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_OUTPUT_HPP
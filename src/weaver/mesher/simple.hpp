@@ -6,151 +6,164 @@
 #include "fwd.hpp"
 #include "voxel_reader.hpp"
 #include "mesher_result.hpp"
+#include "output.hpp"
+#include "welder.hpp"
 #include "cube_def.hpp"
+#include "volume_view.hpp"
+#include "voxel_table.hpp"
 #include <array>
+#include <type_traits>
 
 namespace tc
 {
-template <typename Type> class WEAVER_API simple {
+template <typename Type, typename Output = quad_output> class WEAVER_API simple {
 	enum boundry { r = 0, f = 1, u = 2, count = 3 };
 
     public:
 	template <typename T> using reader_t = weaver::voxel_reader<T>;
 	
+	using result_type = typename Output::result_type;
+
 	template <typename Iter>
-	mesher_result eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
 	{
 		if (add_border) {
-			int32_t dw{ static_cast<int32_t>(width) };
-			int32_t dh{ static_cast<int32_t>(height) };
-			int32_t dd{ static_cast<int32_t>(depth) };
-			int32_t bw{ dw + 2 };
-			int32_t bh{ dh + 2 };
-			int32_t bd{ dd + 2 };
-
-			std::vector<Type *> volume;
-			volume.resize(bw * bh * bd, nullptr);
-			for (auto z = 0; z < dd; ++z) {
-				auto zb = (z + 1) * bh * bw;
-				auto zi = z * dh * dw;
-				for (auto y = 0; y < dh; ++y) {
-					auto yb = (y + 1) * bh + zb;
-					auto yi = y * dh + zi;
-					for (auto x = 0; x < dw; ++x) {
-						auto b = (x + 1) + yb;
-						auto i = x + yi;
-						volume[b] = (volume_begin + i).operator->();
-					}
-				}
-			}
-
-			return work(std::begin(volume), std::end(volume),
-				    reader_t<Type *>{ reader });
+			return eval(weaver::volume_view<Iter>{ volume_begin, volume_end, width, height,
+							       depth },
+				    reader);
 		} else {
-			return work(volume_begin, volume_end, reader);
+			return eval(weaver::padded_volume_view<Iter>{ volume_begin, volume_end, width,
+								      height, depth },
+				    reader);
 		}
 	}
 
-	size_t width{ 0 };
-	size_t height{ 0 };
-	size_t depth{ 0 };
-	bool add_border{ false };
-
-    private:
-	template <typename Iter, typename T>
-	mesher_result work(Iter volume_begin, Iter volume_end, reader_t<T> reader = {}) const
+	/// Meshes the view's chunk, width, height, depth and add_border are taken from the view.
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader = {}) const
 	{
-		int32_t dw{ static_cast<int32_t>(width) };
-		int32_t dh{ static_cast<int32_t>(height) };
-		int32_t dd{ static_cast<int32_t>(depth) };
-		int32_t bw{ dw + 2 };
-		int32_t bh{ dh + 2 };
-		int32_t bd{ dd + 2 };
+		result_type result;
 
-		mesher_result result;
-		auto &quads = result.quads;
+		auto faces = reserve_faces;
+		if (count_faces) {
+			faces = 0;
+			mesh<weaver::internal::face_counter>(view, reader, faces);
+		}
 
-		quads.reserve(height * width * depth * 6);
+		Output::reserve(result, faces);
+		mesh<Output>(view, reader, result);
 
-		auto volume_check = [reader = reader, e = volume_end](auto c) {
-			if (c == e) {
-				return false;
+		if constexpr (std::is_same_v<result_type, mesher_result>) {
+			if (indexed) {
+				weaver::weld_quads(result);
 			}
+		}
 
-			return reader.visible(*c);
-		};
+		return result;
+	}
 
-		vertex vert;
-		auto volume = volume_begin + bh * bw;
-		for (vert.z = 1; vert.z < bd - 1; ++vert.z) {
-			for (vert.y = 0; vert.y < bh; ++vert.y) {
-				for (vert.x = 0; vert.x < bw; ++vert.x, ++volume) {
-					auto vi = volume - volume_begin;
-					const bool in_bounds = is_in_bounds(vert);
-					auto state = volume_check(volume);
+	size_t width{ 0 };
+	size_t height{ 0 };
+	size_t depth{ 0 };
+	bool add_border{ false };
+	/// Output welded, indexed vertices instead of quads, see weaver::weld_quads.
+	bool indexed{ false };
+	/// Faces to reserve output for up front, unused when count_faces is set.
+	size_t reserve_faces{ 0 };
+	/// Count the visible faces in a first pass so the output is allocated once.
+	bool count_faces{ false };
 
-					if (!in_bounds || !state) {
-						// skip if it's not in bounds or not visable
+    private:
+	template <typename Sink, typename View>
+	void mesh(const View &view, reader_t<Type> &reader,
+		  typename Sink::result_type &result) const
+	{
+		vector3i p;
+		for (p.z = 0; p.z < view.depth(); ++p.z) {
+			for (p.y = 0; p.y < view.height(); ++p.y) {
+				for (p.x = 0; p.x < view.width(); ++p.x) {
+					auto volume = view.at(p);
+					if (volume == nullptr || !reader.visible(*volume)) {
+						// skip if it's not visable
 						continue;
 					}
 
-					static const vertex remove_border{ 1.0, 1.0, 1.0 };
-
-					add_quads(vert - remove_border, quads, volume, reader);
+					add_quads<Sink>(p, result, volume, reader);
 				}
 			}
 		}
-
-		return result;
-	}
-
-    private:
-	auto is_in_bounds(const vertex &v) const
-	{
-		return (1.0 <= v.x && v.x <= static_cast<int32_t>(width)) &&
-		       (1.0 <= v.y && v.y <= static_cast<int32_t>(height)) &&
-		       (1.0 <= v.z && v.z <= static_cast<int32_t>(depth));
 	}
 
-	template <typename Iter, typename T>
-	auto add_quads(const vertex &vert, std::vector<quad> &quads, Iter current_vox,
-		       reader_t<T> &reader) const
+	template <typename Sink, typename Ptr>
+	auto add_quads(const vector3i &p, typename Sink::result_type &result, Ptr current_vox,
+		       reader_t<Type> &reader) const
 	{
-		auto faces = cube_faces;
 		auto type_id = reader(*current_vox);
+		const vertex vert{ static_cast<weaver::decimal_t>(p.x), static_cast<weaver::decimal_t>(p.y),
+				   static_cast<weaver::decimal_t>(p.z) };
 
 		for (auto d = 0; d < 3; ++d) {
 			for (auto side = 0; side < 2; ++side) {
 				auto state = side == 1;
 
 				auto index = d + (state ? 0 : 3);
+				auto dir = static_cast<voxel_face>(index);
 
-				auto voxel_defintion =
-					reader(*current_vox, static_cast<voxel_face>(index));
+				if constexpr (std::is_same_v<Sink, weaver::internal::face_counter>) {
+					result += weaver::count_faces(reader, *current_vox, dir);
+					continue;
+				}
 
-				auto base_face = faces[index];
-				base_face.normal.normalize_quick();
-				base_face.type_id = type_id;
+				uint32_t component{ 0 };
+				weaver::for_each_quad(reader, *current_vox, dir, type_id, vert,
+						      [&](auto &&face) {
+							      Sink::emit(result, face,
+									 weaver::face_info{ p, dir,
+											    component++ });
+						      });
+			}
+		}
+	}
+};
 
-				for (auto &&def : voxel_defintion) {
-					auto face = base_face;
-					face.material_id = def.material;
+/// simple for chunks of Width * Height * Depth voxels, see fixed_culling.
+template <typename Type, size_t Width, size_t Height, size_t Depth,
+	  typename Output = quad_output>
+class WEAVER_API fixed_simple : private simple<Type, Output> {
+	using base = simple<Type, Output>;
 
-					std::array<vector2d, 2> uv_space { };
-					uv_space[0] = weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_min); // bottom left
-					uv_space[1] = weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_max); // top right
+    public:
+	template <typename T> using reader_t = weaver::voxel_reader<T>;
 
-					face.for_each([&vert, &base_face, &uv_space, &def](auto i, auto &&p, auto &&uv) {
-						p = clamp(base_face[i], def.min, def.max);
-						p += vert + def.translate;
-						uv = weaver::lerp(uv_space[0], uv_space[1], 1 - uv);
-					});
+	using result_type = typename base::result_type;
 
-					quads.emplace_back(face);
-				}
-			}
+	template <typename Iter>
+	result_type eval(Iter volume_begin, Iter volume_end, reader_t<Type> reader = {}) const
+	{
+		if (add_border) {
+			return eval(weaver::fixed_volume_view<Iter, Width, Height, Depth>{ volume_begin,
+											  volume_end },
+				    reader);
+		} else {
+			return eval(weaver::fixed_padded_volume_view<Iter, Width, Height, Depth>{
+					    volume_begin, volume_end },
+				    reader);
 		}
 	}
+
+	template <typename View>
+	result_type eval(const View &view, reader_t<Type> reader = {}) const
+	{
+		return base::eval(view, std::move(reader));
+	}
+
+	static constexpr size_t width{ Width };
+	static constexpr size_t height{ Height };
+	static constexpr size_t depth{ Depth };
+	using base::add_border;
+	using base::indexed;
+	using base::reserve_faces;
+	using base::count_faces;
 };
 } // namespace tc
 
@@ -0,0 +1,401 @@
+#ifndef WEAVER_MESHER_VOLUME_VIEW_HPP
+#define WEAVER_MESHER_VOLUME_VIEW_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/vector3.hpp"
+#include "../core/voxel_face.hpp"
+#include "voxel_reader.hpp"
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace tc
+{
+namespace weaver
+{
+/// Views give meshers coordinate access to a chunk without copying it.
+/// Positions run from -1 to width/height/depth, the outer layer being the one
+/// voxel border around the chunk. `at` returns nullptr where there is no voxel.
+
+/// View over a chunk of width * height * depth voxels stored x first, then y
+/// and z. The border around it is empty.
+template <typename Iter> class WEAVER_API volume_view {
+    public:
+	using pointer = decltype(std::addressof(*std::declval<Iter>()));
+
+	volume_view(Iter begin, Iter end, size_t width, size_t height, size_t depth)
+		: begin_{ begin }, width_{ static_cast<int32_t>(width) },
+		  height_{ static_cast<int32_t>(height) }, depth_{ static_cast<int32_t>(depth) }
+	{
+		WEAVER_ASSERT(std::distance(begin, end) >= static_cast<std::ptrdiff_t>(width * height * depth));
+	}
+
+	int32_t width() const
+	{
+		return width_;
+	}
+
+	int32_t height() const
+	{
+		return height_;
+	}
+
+	int32_t depth() const
+	{
+		return depth_;
+	}
+
+	pointer at(int32_t x, int32_t y, int32_t z) const
+	{
+		// negative values wrap around and fail the same comparison
+		if (static_cast<uint32_t>(x) >= static_cast<uint32_t>(width_) ||
+		    static_cast<uint32_t>(y) >= static_cast<uint32_t>(height_) ||
+		    static_cast<uint32_t>(z) >= static_cast<uint32_t>(depth_)) {
+			return nullptr;
+		}
+
+		return std::addressof(*(begin_ + ((z * height_ + y) * width_ + x)));
+	}
+
+	pointer at(const vector3i &p) const
+	{
+		return at(p.x, p.y, p.z);
+	}
+
+    private:
+	Iter begin_;
+	int32_t width_{ 0 };
+	int32_t height_{ 0 };
+	int32_t depth_{ 0 };
+};
+
+/// View over a caller provided buffer of (width + 2) * (height + 2) * (depth + 2)
+/// voxels which already stores the border around the chunk.
+template <typename Iter> class WEAVER_API padded_volume_view {
+    public:
+	using pointer = decltype(std::addressof(*std::declval<Iter>()));
+
+	padded_volume_view(Iter begin, Iter end, size_t width, size_t height, size_t depth)
+		: begin_{ begin }, width_{ static_cast<int32_t>(width) },
+		  height_{ static_cast<int32_t>(height) }, depth_{ static_cast<int32_t>(depth) }
+	{
+		WEAVER_ASSERT(std::distance(begin, end) >=
+			      static_cast<std::ptrdiff_t>((width + 2) * (height + 2) * (depth + 2)));
+	}
+
+	int32_t width() const
+	{
+		return width_;
+	}
+
+	int32_t height() const
+	{
+		return height_;
+	}
+
+	int32_t depth() const
+	{
+		return depth_;
+	}
+
+	pointer at(int32_t x, int32_t y, int32_t z) const
+	{
+		WEAVER_ASSERT(-1 <= x && x <= width_ && -1 <= y && y <= height_ && -1 <= z &&
+			      z <= depth_);
+		const auto bw = width_ + 2;
+		const auto bh = height_ + 2;
+		return std::addressof(*(begin_ + (((z + 1) * bh + y + 1) * bw + x + 1)));
+	}
+
+	pointer at(const vector3i &p) const
+	{
+		return at(p.x, p.y, p.z);
+	}
+
+    private:
+	Iter begin_;
+	int32_t width_{ 0 };
+	int32_t height_{ 0 };
+	int32_t depth_{ 0 };
+};
+
+/// volume_view of a chunk whose dimensions are known at compile time, strides
+/// and loop bounds of the meshers become constants.
+template <typename Iter, size_t Width, size_t Height, size_t Depth>
+class WEAVER_API fixed_volume_view {
+    public:
+	using pointer = decltype(std::addressof(*std::declval<Iter>()));
+
+	fixed_volume_view(Iter begin, Iter end) : begin_{ begin }
+	{
+		WEAVER_ASSERT(std::distance(begin, end) >= static_cast<std::ptrdiff_t>(Width * Height * Depth));
+	}
+
+	static constexpr int32_t width()
+	{
+		return static_cast<int32_t>(Width);
+	}
+
+	static constexpr int32_t height()
+	{
+		return static_cast<int32_t>(Height);
+	}
+
+	static constexpr int32_t depth()
+	{
+		return static_cast<int32_t>(Depth);
+	}
+
+	pointer at(int32_t x, int32_t y, int32_t z) const
+	{
+		if (static_cast<uint32_t>(x) >= Width || static_cast<uint32_t>(y) >= Height ||
+		    static_cast<uint32_t>(z) >= Depth) {
+			return nullptr;
+		}
+
+		return std::addressof(*(begin_ + ((z * height() + y) * width() + x)));
+	}
+
+	pointer at(const vector3i &p) const
+	{
+		return at(p.x, p.y, p.z);
+	}
+
+    private:
+	Iter begin_;
+};
+
+/// padded_volume_view of a chunk whose dimensions are known at compile time.
+template <typename Iter, size_t Width, size_t Height, size_t Depth>
+class WEAVER_API fixed_padded_volume_view {
+    public:
+	using pointer = decltype(std::addressof(*std::declval<Iter>()));
+
+	fixed_padded_volume_view(Iter begin, Iter end) : begin_{ begin }
+	{
+		WEAVER_ASSERT(std::distance(begin, end) >=
+			      static_cast<std::ptrdiff_t>((Width + 2) * (Height + 2) * (Depth + 2)));
+	}
+
+	static constexpr int32_t width()
+	{
+		return static_cast<int32_t>(Width);
+	}
+
+	static constexpr int32_t height()
+	{
+		return static_cast<int32_t>(Height);
+	}
+
+	static constexpr int32_t depth()
+	{
+		return static_cast<int32_t>(Depth);
+	}
+
+	pointer at(int32_t x, int32_t y, int32_t z) const
+	{
+		WEAVER_ASSERT(-1 <= x && x <= width() && -1 <= y && y <= height() && -1 <= z &&
+			      z <= depth());
+		constexpr auto bw = width() + 2;
+		constexpr auto bh = height() + 2;
+		return std::addressof(*(begin_ + (((z + 1) * bh + y + 1) * bw + x + 1)));
+	}
+
+	pointer at(const vector3i &p) const
+	{
+		return at(p.x, p.y, p.z);
+	}
+
+    private:
+	Iter begin_;
+};
+
+/// Bit set of voxel faces, bit n is set for static_cast<voxel_face>(n).
+using face_mask = uint8_t;
+
+/// Start of the six chunks around a chunk, indexed by the voxel_face they touch.
+/// Neighbours have the chunk's dimensions and are stored like it, x first.
+template <typename Iter> struct WEAVER_API chunk_neighbors {
+	void set(voxel_face face, Iter begin)
+	{
+		chunks[static_cast<size_t>(face)] = begin;
+	}
+
+	/// The faces that have a neighbour.
+	face_mask planes() const
+	{
+		face_mask mask{ 0 };
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			if (chunks[i]) {
+				mask |= face_mask(1 << i);
+			}
+		}
+		return mask;
+	}
+
+	std::array<std::optional<Iter>, static_cast<size_t>(voxel_face::_count)> chunks;
+};
+
+/// Mesh of a chunk meshed against its neighbours together with the boundary
+/// planes that were culled against neighbour data. The remaining planes have
+/// to be remeshed once their neighbour is loaded.
+template <typename Result> struct WEAVER_API neighbor_mesh {
+	Result mesh;
+	face_mask planes{ 0 };
+};
+
+/// View over a chunk like volume_view, the border is read from the neighbouring
+/// chunks. Edges and corners of the border are empty, meshers only look at
+/// the voxels sharing a face.
+template <typename Iter> class WEAVER_API neighbor_view {
+    public:
+	using pointer = typename volume_view<Iter>::pointer;
+
+	neighbor_view(Iter begin, Iter end, size_t width, size_t height, size_t depth,
+		      const chunk_neighbors<Iter> &neighbors)
+		: center_{ begin, end, width, height, depth }, neighbors_{ neighbors }
+	{
+	}
+
+	int32_t width() const
+	{
+		return center_.width();
+	}
+
+	int32_t height() const
+	{
+		return center_.height();
+	}
+
+	int32_t depth() const
+	{
+		return center_.depth();
+	}
+
+	face_mask planes() const
+	{
+		return neighbors_.planes();
+	}
+
+	pointer at(int32_t x, int32_t y, int32_t z) const
+	{
+		const auto w = center_.width();
+		const auto h = center_.height();
+		const auto d = center_.depth();
+
+		const auto ox = x < 0 ? -1 : x >= w ? 1 : 0;
+		const auto oy = y < 0 ? -1 : y >= h ? 1 : 0;
+		const auto oz = z < 0 ? -1 : z >= d ? 1 : 0;
+		if ((ox | oy | oz) == 0) {
+			return center_.at(x, y, z);
+		}
+
+		if ((ox != 0) + (oy != 0) + (oz != 0) != 1) {
+			return nullptr;
+		}
+
+		voxel_face face;
+		if (ox != 0) {
+			face = ox > 0 ? voxel_face::right : voxel_face::left;
+			x -= ox * w;
+		} else if (oy != 0) {
+			face = oy > 0 ? voxel_face::back : voxel_face::front;
+			y -= oy * h;
+		} else {
+			face = oz > 0 ? voxel_face::top : voxel_face::bottom;
+			z -= oz * d;
+		}
+
+		auto &&chunk = neighbors_.chunks[static_cast<size_t>(face)];
+		if (!chunk || static_cast<uint32_t>(x) >= static_cast<uint32_t>(w) ||
+		    static_cast<uint32_t>(y) >= static_cast<uint32_t>(h) ||
+		    static_cast<uint32_t>(z) >= static_cast<uint32_t>(d)) {
+			return nullptr;
+		}
+
+		return std::addressof(*(*chunk + ((z * h + y) * w + x)));
+	}
+
+	pointer at(const vector3i &p) const
+	{
+		return at(p.x, p.y, p.z);
+	}
+
+    private:
+	volume_view<Iter> center_;
+	chunk_neighbors<Iter> neighbors_;
+};
+
+enum class chunk_content
+{
+	/// Anything else, meshed voxel by voxel.
+	mixed,
+	/// No visible voxel, there is nothing to mesh.
+	empty,
+	/// Visible voxels of one type whose faces hide every neighbouring face,
+	/// only the outer layer of the chunk can have visible faces.
+	solid,
+};
+
+/// Pre-scan of a chunk detecting uniform content, stops at the first voxel
+/// making the chunk mixed. The border is not looked at.
+/// Whether the faces of a solid chunk hide their neighbours is read from every
+/// voxel, or only from the first one when the reader declares
+/// weaver::faces_by_type.
+template <typename View, typename Reader>
+chunk_content scan_content(const View &view, const Reader &reader)
+{
+	const auto first = view.at(0, 0, 0);
+	if (first == nullptr) {
+		return chunk_content::empty;
+	}
+
+	const bool visible = reader.visible(*first);
+	const auto type_id = visible ? reader(*first) : unset_voxel_id;
+	if (visible && type_id == unset_voxel_id) {
+		// voxels without a type id can't be told apart
+		return chunk_content::mixed;
+	}
+
+	for (int32_t z = 0; z < view.depth(); ++z) {
+		for (int32_t y = 0; y < view.height(); ++y) {
+			for (int32_t x = 0; x < view.width(); ++x) {
+				auto &&v = *view.at(x, y, z);
+				if (reader.visible(v) != visible || (visible && reader(v) != type_id)) {
+					return chunk_content::mixed;
+				}
+			}
+		}
+	}
+
+	if (!visible) {
+		return chunk_content::empty;
+	}
+
+	constexpr uint8_t all_faces = (1 << static_cast<size_t>(voxel_face::_count)) - 1;
+	if constexpr (faces_by_type_v<Reader>) {
+		if (cull_mask(reader, *first) != all_faces) {
+			return chunk_content::mixed;
+		}
+	} else {
+		for (int32_t z = 0; z < view.depth(); ++z) {
+			for (int32_t y = 0; y < view.height(); ++y) {
+				for (int32_t x = 0; x < view.width(); ++x) {
+					if (cull_mask(reader, *view.at(x, y, z)) != all_faces) {
+						return chunk_content::mixed;
+					}
+				}
+			}
+		}
+	}
+
+	return chunk_content::solid;
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_VOLUME_VIEW_HPP
@@ -18,7 +18,8 @@ namespace weaver
 		vector3d translate{ 0.0, 0.0, 0.0 };
 		vector2d uv_min{ 0.0, 0.0 };
 		vector2d uv_max{ 1.0, 1.0 };
-		std::string_view material{};
+		/// See weaver::material_registry.
+		material_id_t material{ no_material_id };
 		bool cull{ true };
 	};
 }
@@ -7,6 +7,11 @@
 #include "../core/quad.hpp"
 #include "../core/voxel_face.hpp"
 #include "voxel_face_result.hpp"
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace tc
 {
@@ -29,7 +34,82 @@ template <typename Type> struct WEAVER_API voxel_reader {
 	}
 };
 
+/// Non owning view over face results kept alive by the reader.
+struct WEAVER_API voxel_face_range {
+	const voxel_face_result *begin() const
+	{
+		return first;
+	}
+
+	const voxel_face_result *end() const
+	{
+		return last;
+	}
+
+	size_t size() const
+	{
+		return static_cast<size_t>(last - first);
+	}
+
+	bool empty() const
+	{
+		return first == last;
+	}
+
+	const voxel_face_result *first{ nullptr };
+	const voxel_face_result *last{ nullptr };
+};
+
+/// Readers may provide `voxel_face_range faces(const Type &, voxel_face) const`
+/// pointing into storage they own, avoiding the vector returned by
+/// `operator()(const Type &, voxel_face)` on every query.
+template <typename Reader, typename Type, typename = void>
+struct has_face_range : std::false_type {
+};
+
+template <typename Reader, typename Type>
+struct has_face_range<Reader, Type,
+		      std::void_t<decltype(std::declval<const Reader &>().faces(
+			      std::declval<const Type &>(), voxel_face{}))>> : std::true_type {
+};
+
+template <typename Reader, typename Type>
+static constexpr bool has_face_range_v = has_face_range<Reader, Type>::value;
+
+/// Readers whose faces only depend on the type id of a voxel may declare
+/// `static constexpr bool faces_by_type = true;`, meshers then cache what the
+/// faces of a voxel hide by its type id, see cull_mask_cache. Other readers
+/// are queried for every voxel.
+template <typename Reader, typename = void> struct faces_by_type : std::false_type {
+};
+
+template <typename Reader>
+struct faces_by_type<Reader, std::void_t<decltype(Reader::faces_by_type)>>
+	: std::bool_constant<Reader::faces_by_type> {
+};
+
+template <typename Reader>
+static constexpr bool faces_by_type_v = faces_by_type<Reader>::value;
+
+/// Readers may provide `uint8_t cull_mask(const Type &) const`, usually from a
+/// voxel_table, meshers then take what the faces of a voxel hide from it
+/// instead of querying every face, see weaver::cull_mask.
+template <typename Reader, typename Type, typename = void>
+struct has_cull_mask : std::false_type {
+};
+
+template <typename Reader, typename Type>
+struct has_cull_mask<Reader, Type,
+		     std::void_t<decltype(std::declval<const Reader &>().cull_mask(
+			     std::declval<const Type &>()))>> : std::true_type {
+};
+
+template <typename Reader, typename Type>
+static constexpr bool has_cull_mask_v = has_cull_mask<Reader, Type>::value;
+
 template <typename Type> struct voxel_reader<Type *> {
+	static constexpr bool faces_by_type = faces_by_type_v<voxel_reader<Type>>;
+
 	inline bool visible(const Type *v) const
 	{
 		return v == nullptr ? false : reader.visible(*v);
@@ -45,8 +125,122 @@ template <typename Type> struct voxel_reader<Type *> {
 		return v == nullptr ? std::vector<voxel_face_result>{ voxel_face_result{} } : reader(*v, vf);
 	}
 
+	template <typename Reader = voxel_reader<Type>,
+		  std::enable_if_t<has_face_range_v<Reader, Type>, int32_t> = 0>
+	inline voxel_face_range faces(const Type *v, voxel_face vf) const
+	{
+		return v == nullptr ? voxel_face_range{ &empty_face, &empty_face + 1 } :
+					    reader.faces(*v, vf);
+	}
+
+	template <typename Reader = voxel_reader<Type>,
+		  std::enable_if_t<has_cull_mask_v<Reader, Type>, int32_t> = 0>
+	inline uint8_t cull_mask(const Type *v) const
+	{
+		return v == nullptr ? 0 : reader.cull_mask(*v);
+	}
+
+	inline static const voxel_face_result empty_face{};
+
 	voxel_reader<Type> reader{};
 };
+
+/// Calls fn for each face result of the voxel, using the allocation free
+/// `faces` query when the reader provides it.
+template <typename Reader, typename Type, typename Fn>
+static void for_each_face(const Reader &reader, const Type &v, voxel_face vf, Fn &&fn)
+{
+	if constexpr (has_face_range_v<Reader, Type>) {
+		for (auto &&def : reader.faces(v, vf)) {
+			fn(def);
+		}
+	} else {
+		for (auto &&def : reader(v, vf)) {
+			fn(def);
+		}
+	}
+}
+
+/// Number of face results of the voxel's face.
+template <typename Reader, typename Type>
+static size_t count_faces(const Reader &reader, const Type &v, voxel_face vf)
+{
+	if constexpr (has_face_range_v<Reader, Type>) {
+		return reader.faces(v, vf).size();
+	} else {
+		return reader(v, vf).size();
+	}
+}
+
+/// True when any part of the voxel's face hides the face of its neighbor.
+template <typename Reader, typename Type>
+static bool face_culls(const Reader &reader, const Type &v, voxel_face vf)
+{
+	if constexpr (has_face_range_v<Reader, Type>) {
+		for (auto &&def : reader.faces(v, vf)) {
+			if (def.cull) {
+				return true;
+			}
+		}
+	} else {
+		for (auto &&def : reader(v, vf)) {
+			if (def.cull) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/// Bit f is set when face f of the voxel hides the face of its neighbor.
+template <typename Reader, typename Type> uint8_t cull_mask(const Reader &reader, const Type &v)
+{
+	if constexpr (has_cull_mask_v<Reader, Type>) {
+		return reader.cull_mask(v);
+	}
+
+	uint8_t mask{ 0 };
+	for (size_t i = 0; i < static_cast<size_t>(voxel_face::_count); ++i) {
+		if (face_culls(reader, v, static_cast<voxel_face>(i))) {
+			mask |= static_cast<uint8_t>(1 << i);
+		}
+	}
+
+	return mask;
+}
+
+/// cull_mask of the voxels of a chunk. The masks are cached by type id when
+/// the reader declares faces_by_type, otherwise every voxel is queried.
+class WEAVER_API cull_mask_cache {
+    public:
+	void clear()
+	{
+		masks_.clear();
+	}
+
+	template <typename Reader, typename Type>
+	uint8_t operator()(const Reader &reader, const Type &v)
+	{
+		if constexpr (!faces_by_type_v<Reader> || has_cull_mask_v<Reader, Type>) {
+			return cull_mask(reader, v);
+		} else {
+			const auto type_id = reader(v);
+			if (type_id == unset_voxel_id) {
+				return cull_mask(reader, v);
+			}
+
+			auto it = masks_.find(type_id);
+			if (it == std::end(masks_)) {
+				it = masks_.emplace(type_id, cull_mask(reader, v)).first;
+			}
+			return it->second;
+		}
+	}
+
+    private:
+	std::unordered_map<voxel_id_t, uint8_t> masks_;
+};
 } // namespace weaver
 } // namespace tc
 
@@ -0,0 +1,371 @@
+#ifndef WEAVER_MESHER_VOXEL_TABLE_HPP
+#define WEAVER_MESHER_VOXEL_TABLE_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/algorithm.hpp"
+#include "../core/material_registry.hpp"
+#include "../core/quad.hpp"
+#include "../core/vertex.hpp"
+#include "../core/voxel_def.hpp"
+#include "../core/voxel_face.hpp"
+#include "cube_def.hpp"
+#include "voxel_face_result.hpp"
+#include "voxel_reader.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+/// A voxel_face_result with the parts meshers compute for every face done up front.
+struct WEAVER_API baked_face {
+	/// Face corners clamped to the component, in quad corner order.
+	std::array<vertex, 4> corners{};
+	vertex translate{};
+	std::array<quad::uv_t, 4> uvs{};
+	material_id_t material{ no_material_id };
+	bool cull{ true };
+};
+
+struct WEAVER_API baked_face_range {
+	const baked_face *begin() const
+	{
+		return first;
+	}
+
+	const baked_face *end() const
+	{
+		return last;
+	}
+
+	size_t size() const
+	{
+		return static_cast<size_t>(last - first);
+	}
+
+	bool empty() const
+	{
+		return first == last;
+	}
+
+	const baked_face *first{ nullptr };
+	const baked_face *last{ nullptr };
+};
+
+/// Readers may provide `baked_face_range baked(const Type &, voxel_face) const`,
+/// usually from a voxel_table, meshers then build quads without computing them.
+template <typename Reader, typename Type, typename = void>
+struct has_baked_faces : std::false_type {
+};
+
+template <typename Reader, typename Type>
+struct has_baked_faces<Reader, Type,
+		       std::void_t<decltype(std::declval<const Reader &>().baked(
+			       std::declval<const Type &>(), voxel_face{}))>> : std::true_type {
+};
+
+template <typename Reader, typename Type>
+static constexpr bool has_baked_faces_v = has_baked_faces<Reader, Type>::value;
+
+/// Thrown by voxel_table::compile when two definitions share a type index.
+class WEAVER_API voxel_index_collision : public std::runtime_error {
+    public:
+	voxel_index_collision(uint32_t index, std::string first, std::string second)
+		: std::runtime_error{ "voxel type index " + std::to_string(index) + " of " + first +
+				      " collides with " + second },
+		  index{ index }, first{ std::move(first) }, second{ std::move(second) }
+	{
+	}
+
+	uint32_t index;
+	std::string first;
+	std::string second;
+};
+
+/// Definitions compiled into flat arrays indexed by a dense type index and face,
+/// built once after loading. Readers look faces up with the type index stored
+/// in their voxels, there is no hashing or string work involved:
+///
+///     voxel_face_range faces(const voxel &v, voxel_face f) const { return table->faces(v.index, f); }
+///     baked_face_range baked(const voxel &v, voxel_face f) const { return table->baked(v.index, f); }
+///     uint8_t cull_mask(const voxel &v) const { return table->cull_mask(v.index); }
+///
+/// A component contributes to a face when it defines that face.
+class WEAVER_API voxel_table {
+	struct span {
+		uint32_t first{ 0 };
+		uint32_t count{ 0 };
+	};
+
+	static constexpr size_t face_count = static_cast<size_t>(voxel_face::_count);
+
+    public:
+	static constexpr uint32_t npos = UINT32_MAX;
+
+	/// Compiles a range of voxel_def, of pairs with a voxel_def second like
+	/// the definitions of voxel_load_result, or of voxel_def pointers like
+	/// by_index, null pointers are skipped. Type indices are the voxel_def::index
+	/// a load assigned, so they match voxel_load_result::by_index, otherwise they
+	/// follow the type ids. Indices without a definition have no faces.
+	/// Material ids are taken from the registry, new names are added to it.
+	/// Throws voxel_index_collision when two definitions share an index.
+	template <typename Range>
+	static voxel_table compile(const Range &definitions, material_registry &materials)
+	{
+		std::vector<const voxel_def *> defs;
+		bool indexed{ true };
+		for (auto &&entry : definitions) {
+			auto def = get_def(entry);
+			if (def == nullptr) {
+				continue;
+			}
+
+			defs.emplace_back(def);
+			indexed = indexed && defs.back()->index != no_voxel_index;
+		}
+
+		if (indexed) {
+			uint32_t count{ 0 };
+			for (auto &&def : defs) {
+				count = std::max(count, def->index + 1);
+			}
+
+			std::vector<const voxel_def *> slots(count, nullptr);
+			for (auto &&def : defs) {
+				if (auto other = slots[def->index]; other != nullptr) {
+					throw voxel_index_collision{ def->index, other->name, def->name };
+				}
+				slots[def->index] = def;
+			}
+			defs = std::move(slots);
+		} else {
+			std::sort(std::begin(defs), std::end(defs),
+				  [](auto &&l, auto &&r) { return l->type < r->type; });
+		}
+
+		voxel_table table;
+
+		table.type_ids_.reserve(defs.size());
+		table.lookup_.reserve(defs.size());
+		table.spans_.reserve(defs.size() * face_count);
+		table.cull_masks_.reserve(defs.size());
+		for (auto &&def : defs) {
+			if (def == nullptr) {
+				table.type_ids_.emplace_back(unset_voxel_id);
+				table.spans_.resize(table.spans_.size() + face_count);
+				table.cull_masks_.emplace_back(0);
+				continue;
+			}
+
+			table.lookup_.emplace_back(def->type,
+						   static_cast<uint32_t>(table.type_ids_.size()));
+			table.type_ids_.emplace_back(def->type);
+
+			uint8_t cull_mask{ 0 };
+			for (size_t f = 0; f < face_count; ++f) {
+				const auto face = static_cast<voxel_face>(f);
+
+				span s{ static_cast<uint32_t>(table.results_.size()), 0 };
+				for (auto &&component : def->components) {
+					auto it = component.faces.find(face);
+					if (it == std::end(component.faces)) {
+						continue;
+					}
+
+					auto &&face_def = it->second;
+					const auto material = materials.intern(face_def.material);
+
+					voxel_face_result result;
+					result.min = component.min;
+					result.max = component.max;
+					result.translate = component.translate;
+					result.uv_min = face_def.uv_min;
+					result.uv_max = face_def.uv_max;
+					result.material = material;
+					result.cull = face_def.cull;
+
+					table.results_.emplace_back(result);
+					table.baked_.emplace_back(bake(result, face));
+					++s.count;
+
+					if (face_def.cull) {
+						cull_mask |= static_cast<uint8_t>(1 << f);
+					}
+				}
+
+				table.spans_.emplace_back(s);
+			}
+
+			table.cull_masks_.emplace_back(cull_mask);
+		}
+		std::sort(std::begin(table.lookup_), std::end(table.lookup_));
+
+		return table;
+	}
+
+	/// compile with a registry of its own, see materials().
+	template <typename Range> static voxel_table compile(const Range &definitions)
+	{
+		material_registry materials;
+		auto table = compile(definitions, materials);
+		table.materials_ = std::move(materials);
+		return table;
+	}
+
+	/// Number of types.
+	size_t size() const
+	{
+		return type_ids_.size();
+	}
+
+	/// Dense index of a type id or npos.
+	uint32_t index(voxel_id_t type_id) const
+	{
+		auto it = std::lower_bound(std::begin(lookup_), std::end(lookup_),
+					   std::make_pair(type_id, uint32_t{ 0 }));
+		if (it == std::end(lookup_) || it->first != type_id) {
+			return npos;
+		}
+
+		return it->second;
+	}
+
+	voxel_id_t type_id(uint32_t index) const
+	{
+		WEAVER_ASSERT(index < type_ids_.size());
+		return type_ids_[index];
+	}
+
+	voxel_face_range faces(uint32_t index, voxel_face face) const
+	{
+		auto &&s = find(index, face);
+		const auto first = results_.data() + s.first;
+		return voxel_face_range{ first, first + s.count };
+	}
+
+	baked_face_range baked(uint32_t index, voxel_face face) const
+	{
+		auto &&s = find(index, face);
+		const auto first = baked_.data() + s.first;
+		return baked_face_range{ first, first + s.count };
+	}
+
+	/// Bit f is set when face f hides the face of its neighbour, readers
+	/// providing it spare the meshers a query of every face.
+	uint8_t cull_mask(uint32_t index) const
+	{
+		WEAVER_ASSERT(index < cull_masks_.size());
+		return cull_masks_[index];
+	}
+
+	/// Materials of a table compiled without a registry, empty otherwise.
+	const material_registry &materials() const
+	{
+		return materials_;
+	}
+
+    private:
+	static const voxel_def *get_def(const voxel_def &def)
+	{
+		return &def;
+	}
+
+	static const voxel_def *get_def(const voxel_def *def)
+	{
+		return def;
+	}
+
+	template <typename Key> static const voxel_def *get_def(const std::pair<Key, voxel_def> &entry)
+	{
+		return &entry.second;
+	}
+
+	static baked_face bake(const voxel_face_result &def, voxel_face face)
+	{
+		// the same steps meshers take for a voxel_face_result
+		auto &&base_face = cube_faces[static_cast<size_t>(face)];
+
+		std::array<quad::uv_t, 2> uv_space{};
+		uv_space[0] = lerp(base_face.uv[0], base_face.uv[2], def.uv_min); // bottom left
+		uv_space[1] = lerp(base_face.uv[0], base_face.uv[2], def.uv_max); // top right
+
+		baked_face baked;
+		for (size_t i = 0; i < 4; ++i) {
+			baked.corners[i] = clamp(base_face[i], vertex{ def.min }, vertex{ def.max });
+			baked.uvs[i] = lerp(uv_space[0], uv_space[1], 1 - base_face.uv[i]);
+		}
+		baked.translate = vertex{ def.translate };
+		baked.material = def.material;
+		baked.cull = def.cull;
+		return baked;
+	}
+
+	const span &find(uint32_t index, voxel_face face) const
+	{
+		WEAVER_ASSERT(index < type_ids_.size());
+		return spans_[index * face_count + static_cast<size_t>(face)];
+	}
+
+	std::vector<voxel_id_t> type_ids_;
+	/// Type ids and their index, sorted by type id.
+	std::vector<std::pair<voxel_id_t, uint32_t>> lookup_;
+	std::vector<span> spans_;
+	std::vector<voxel_face_result> results_;
+	std::vector<baked_face> baked_;
+	std::vector<uint8_t> cull_masks_;
+	material_registry materials_;
+};
+
+/// Builds the quads of a voxel's face at vert and calls fn(const quad &) for
+/// each, using the reader's baked faces when it has them.
+template <typename Reader, typename Type, typename Fn>
+void for_each_quad(const Reader &reader, const Type &v, voxel_face dir, voxel_id_t type_id,
+		   const vertex &vert, Fn &&fn)
+{
+	auto base_face = cube_faces[static_cast<size_t>(dir)];
+	base_face.normal.normalize_quick();
+	base_face.type_id = type_id;
+
+	if constexpr (has_baked_faces_v<Reader, Type>) {
+		for (auto &&baked : reader.baked(v, dir)) {
+			auto face = base_face;
+			face.material_id = baked.material;
+			face.for_each([&vert, &baked](auto i, auto &&p, auto &&uv) {
+				p = baked.corners[i];
+				p += vert + baked.translate;
+				uv = baked.uvs[i];
+			});
+
+			fn(face);
+		}
+	} else {
+		for_each_face(reader, v, dir, [&](auto &&def) {
+			auto face = base_face;
+			face.material_id = def.material;
+
+			std::array<quad::uv_t, 2> uv_space{};
+			uv_space[0] = lerp(base_face.uv[0], base_face.uv[2], def.uv_min); // bottom left
+			uv_space[1] = lerp(base_face.uv[0], base_face.uv[2], def.uv_max); // top right
+
+			face.for_each([&vert, &base_face, &uv_space, &def](auto i, auto &&p, auto &&uv) {
+				p = clamp(base_face[i], vertex{ def.min }, vertex{ def.max });
+				p += vert + def.translate;
+				uv = lerp(uv_space[0], uv_space[1], 1 - uv);
+			});
+
+			fn(face);
+		});
+	}
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_VOXEL_TABLE_HPP
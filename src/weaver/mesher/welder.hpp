@@ -0,0 +1,119 @@
+#ifndef WEAVER_MESHER_WELDER_HPP
+#define WEAVER_MESHER_WELDER_HPP
+
+#include "../config/config.hpp"
+#include "../core/attributes.hpp"
+#include "../core/quad.hpp"
+#include "mesher_result.hpp"
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace tc
+{
+namespace weaver
+{
+namespace internal
+{
+	struct weld_key {
+		bool operator==(const weld_key &o) const
+		{
+			return position.x == o.position.x && position.y == o.position.y &&
+			       position.z == o.position.z && normal.x == o.normal.x &&
+			       normal.y == o.normal.y && normal.z == o.normal.z && uv.x == o.uv.x &&
+			       uv.y == o.uv.y && material_id == o.material_id;
+		}
+
+		vertex position;
+		quad::normal_t normal;
+		quad::uv_t uv;
+		material_id_t material_id;
+	};
+
+	struct weld_key_hash {
+		size_t operator()(const weld_key &k) const
+		{
+			std::hash<decimal_t> hd;
+			size_t h = k.material_id;
+			for (auto v : { k.position.x, k.position.y, k.position.z, k.normal.x, k.normal.y,
+					k.normal.z, k.uv.x, k.uv.y }) {
+				h ^= hd(v) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+			}
+			return h;
+		}
+	};
+} // namespace internal
+
+/// Converts the quads of the result into indexed triangles, sharing corners
+/// with the same position, normal, uv and material.
+/// Triangles are grouped into one section per material, sections appear in
+/// the order their material is first used.
+/// 16 bit indices are used when the welded vertex count fits.
+static void weld_quads(mesher_result &result, bool keep_quads = false)
+{
+	result.vertices.clear();
+	result.normals.clear();
+	result.uvs.clear();
+	result.indices = index_buffer{};
+	result.sections.clear();
+
+	std::unordered_map<internal::weld_key, uint32_t, internal::weld_key_hash> lookup;
+	lookup.reserve(result.quads.size() * 2);
+
+	std::unordered_map<material_id_t, size_t> section_lookup;
+	std::vector<std::vector<uint32_t>> section_indices;
+
+	for (auto &&q : result.quads) {
+		auto it = section_lookup.find(q.material_id);
+		if (it == std::end(section_lookup)) {
+			it = section_lookup.emplace(q.material_id, section_indices.size()).first;
+			section_indices.emplace_back();
+			result.sections.emplace_back(mesh_section{ q.material_id });
+		}
+
+		std::array<uint32_t, 4> corners{};
+		q.for_each([&](auto i, auto &&p, auto &&uv) {
+			internal::weld_key key{ p, q.normal, uv, q.material_id };
+			auto next = static_cast<uint32_t>(result.vertices.size());
+			auto inserted = lookup.emplace(key, next);
+			if (inserted.second) {
+				result.vertices.emplace_back(p);
+				result.normals.emplace_back(q.normal);
+				result.uvs.emplace_back(uv);
+			}
+			corners[i] = inserted.first->second;
+		});
+
+		auto &&indices = section_indices[it->second];
+		for (auto t : { quad::triangle::first, quad::triangle::second }) {
+			for (auto i : q.get_triange(t)) {
+				indices.emplace_back(corners[i]);
+			}
+		}
+	}
+
+	std::vector<uint32_t> indices;
+	indices.reserve(result.quads.size() * 6);
+	for (size_t s = 0; s < section_indices.size(); ++s) {
+		result.sections[s].first_index = indices.size();
+		result.sections[s].index_count = section_indices[s].size();
+		indices.insert(std::end(indices), std::begin(section_indices[s]),
+			       std::end(section_indices[s]));
+	}
+
+	if (result.vertices.size() <= std::numeric_limits<uint16_t>::max()) {
+		result.indices.narrow.assign(std::begin(indices), std::end(indices));
+	} else {
+		result.indices.wide = std::move(indices);
+	}
+
+	if (!keep_quads) {
+		result.quads.clear();
+		result.quads.shrink_to_fit();
+	}
+}
+} // namespace weaver
+} // namespace tc
+
+#endif // WEAVER_MESHER_WELDER_HPP
@@ -0,0 +1,184 @@
+#ifndef WEAVER_TESTS_COMMON_HPP
+#define WEAVER_TESTS_COMMON_HPP
+
+#include "weaver/core/quad.hpp"
+#include "weaver/mesher/voxel_reader.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+/// Records a failed check and carries on, so one run reports every failure.
+#define WEAVER_CHECK(condition)                                                           \
+	do {                                                                              \
+		if (!(condition)) {                                                       \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				     #condition);                                         \
+			++weaver_test::failures;                                          \
+		}                                                                         \
+	} while (false)
+
+namespace weaver_test
+{
+inline int failures{ 0 };
+
+/// Exit code of a test, non zero once a check failed.
+inline int result()
+{
+	if (failures != 0) {
+		std::fprintf(stderr, "%d checks failed\n", failures);
+	}
+	return failures == 0 ? 0 : 1;
+}
+
+/// 0 is air, 1 and 2 are plain cubes, 3 is a cube that doesn't cull its
+/// neighbours (glass), 4 is a lower half slab that only culls downwards and
+/// samples a quarter of its texture.
+struct voxel {
+	uint8_t id{ 0 };
+};
+
+/// Fills a chunk with a solid floor and random voxels of ids [1, max_id] above.
+inline std::vector<voxel> random_chunk(int32_t width, int32_t height, int32_t depth, unsigned seed,
+				       uint8_t max_id = 4)
+{
+	std::vector<voxel> voxels(static_cast<size_t>(width * height * depth));
+	std::mt19937 rng{ seed };
+	for (int32_t z = 0; z < depth; ++z) {
+		for (int32_t y = 0; y < height; ++y) {
+			for (int32_t x = 0; x < width; ++x) {
+				auto &&v = voxels[x + y * width + z * width * height];
+				if (z < depth / 3) {
+					v.id = 1;
+				} else if (rng() % 3 == 0) {
+					v.id = static_cast<uint8_t>(1 + rng() % max_id);
+				}
+			}
+		}
+	}
+
+	return voxels;
+}
+
+using quad_key = std::array<double, 26>;
+
+/// Everything of a quad, for comparing meshes regardless of quad order.
+inline quad_key key(const tc::quad &q)
+{
+	quad_key k{};
+	size_t i{ 0 };
+	q.for_each([&](auto, auto &&p, auto &&uv) {
+		k[i++] = p.x;
+		k[i++] = p.y;
+		k[i++] = p.z;
+		k[i++] = uv.x;
+		k[i++] = uv.y;
+	});
+	k[i++] = q.normal.x;
+	k[i++] = q.normal.y;
+	k[i++] = q.normal.z;
+	k[i++] = q.type_id;
+	k[i++] = q.material_id;
+	return k;
+}
+
+inline std::vector<quad_key> keys(const std::vector<tc::quad> &quads)
+{
+	std::vector<quad_key> result;
+	result.reserve(quads.size());
+	for (auto &&q : quads) {
+		result.emplace_back(key(q));
+	}
+	std::sort(std::begin(result), std::end(result));
+	return result;
+}
+
+/// A fresh, empty directory below the system temp directory.
+inline std::filesystem::path temp_dir(const std::string &name)
+{
+	auto dir = std::filesystem::temp_directory_path() /
+		   ("weaver_" + name + "_" + std::to_string(std::random_device{}()));
+	std::error_code ignored;
+	std::filesystem::remove_all(dir, ignored);
+	std::filesystem::create_directories(dir);
+	return dir;
+}
+
+inline void write_file(const std::filesystem::path &path, const std::string &content)
+{
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	stream << content;
+}
+
+/// Definitions covering inheritance, material keys, partial components and
+/// a file without a name, plus count plain cubes.
+inline void write_definitions(const std::filesystem::path &dir, size_t count)
+{
+	write_file(dir / "cube.json",
+		   R"({"name": "cube", "components": [{"face": {"north": {"material": "${all}"},
+		   "south": {"material": "${all}"}, "east": {"material": "${all}"},
+		   "west": {"material": "${all}"}, "top": {"material": "${all}"},
+		   "bottom": {"material": "${all}"}}}]})");
+	write_file(dir / "log.json",
+		   R"({"name": "log", "components": [{"face": {"north": {"material": "${side}"},
+		   "top": {"material": "${cap}"}, "bottom": {"material": "${cap}"}}},
+		   {"min": [0, 0, 0], "max": [1, 1, 0.5], "face": {"east": {"material": "${side}"}}}]})");
+	write_file(dir / "oak.json", R"({"name": "oak", "$parent": "log",
+		   "materials": {"side": "oak_side", "cap": "oak_top"}})");
+	write_file(dir / "oak2.json",
+		   R"({"name": "oak2", "$parent": "oak", "materials": {"side": "ignored"}})");
+	write_file(dir / "fancy.json",
+		   R"({"name": "fancy", "extra": {"x": [1, 2, {"y": 3}]}, "components": [{"min": [0, 0.25, 0],
+		   "max": [1, 0.75, 1], "translate": [0, 1, 2], "face": {"top": {"uv_min": [0.5, 0.5],
+		   "uv_max": [1, 1], "cull": false, "material": "${m}"}, "weird": {"material": "x"},
+		   "north": {"material": "plain"}}}, {"face": {"bottom": {"material": "${m}"}}}],
+		   "materials": {"m": "gold"}})");
+	write_file(dir / "noname.json", R"({"$parent": "fancy", "materials": {"m": "silver"}})");
+
+	for (size_t i = 0; i < count; ++i) {
+		const auto name = "block" + std::to_string(i);
+		const auto material = "mat" + std::to_string(i % 37);
+		write_file(dir / (name + ".json"),
+			   R"({"name": ")" + name + R"(", "$parent": "cube", "materials": {"all": ")" +
+				   material + R"("}})");
+	}
+}
+} // namespace weaver_test
+
+namespace tc::weaver
+{
+template <> struct voxel_reader<weaver_test::voxel> {
+	static constexpr bool faces_by_type = true;
+
+	bool visible(const weaver_test::voxel &v) const
+	{
+		return v.id != 0;
+	}
+
+	voxel_id_t operator()(const weaver_test::voxel &v) const
+	{
+		return v.id;
+	}
+
+	std::vector<voxel_face_result> operator()(const weaver_test::voxel &v, voxel_face f) const
+	{
+		voxel_face_result r;
+		r.material = static_cast<material_id_t>(v.id);
+		r.cull = v.id != 3;
+		if (v.id == 4) {
+			r.max.z = 0.5;
+			r.uv_max = vector2d{ 0.5, 0.5 };
+			r.cull = f == voxel_face::bottom;
+		}
+		return { r };
+	}
+};
+} // namespace tc::weaver
+
+#endif // WEAVER_TESTS_COMMON_HPP
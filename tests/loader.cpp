@@ -0,0 +1,221 @@
+#include "common.hpp"
+#include "weaver/core/thread_pool.hpp"
+#include "weaver/core/voxel_cache.hpp"
+#include "weaver/core/voxel_loader.hpp"
+
+namespace weaver = tc::weaver;
+
+namespace
+{
+bool equal(const tc::vector3d &l, const tc::vector3d &r)
+{
+	return l.x == r.x && l.y == r.y && l.z == r.z;
+}
+
+bool equal(const tc::vector2d &l, const tc::vector2d &r)
+{
+	return l.x == r.x && l.y == r.y;
+}
+
+bool equal(const tc::voxel_def &l, const tc::voxel_def &r)
+{
+	if (l.name != r.name || l.type != r.type || l.index != r.index ||
+	    l.components.size() != r.components.size()) {
+		return false;
+	}
+
+	for (size_t c = 0; c < l.components.size(); ++c) {
+		auto &&lc = l.components[c];
+		auto &&rc = r.components[c];
+		if (!equal(lc.min, rc.min) || !equal(lc.max, rc.max) ||
+		    !equal(lc.translate, rc.translate) || lc.faces.size() != rc.faces.size()) {
+			return false;
+		}
+
+		for (auto &&[face, def] : lc.faces) {
+			auto it = rc.faces.find(face);
+			if (it == std::end(rc.faces) || def.material != it->second.material ||
+			    def.cull != it->second.cull || !equal(def.uv_min, it->second.uv_min) ||
+			    !equal(def.uv_max, it->second.uv_max)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/// Everything but the json, which only the DOM path keeps.
+bool equal(const weaver::voxel_load_result &l, const weaver::voxel_load_result &r)
+{
+	if (l.definitions.size() != r.definitions.size() || l.name_lookup != r.name_lookup ||
+	    l.materials.size() != r.materials.size() || l.by_index.size() != r.by_index.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < l.materials.size(); ++i) {
+		const auto id = static_cast<weaver::material_id_t>(i);
+		if (l.materials.name(id) != r.materials.name(id)) {
+			return false;
+		}
+	}
+
+	for (auto &&[name, def] : l.definitions) {
+		auto it = r.definitions.find(name);
+		if (it == std::end(r.definitions) || !equal(def, it->second)) {
+			return false;
+		}
+	}
+
+	for (size_t i = 0; i < l.by_index.size(); ++i) {
+		if (l.by_index[i] == nullptr || r.by_index[i] == nullptr ||
+		    l.by_index[i]->name != r.by_index[i]->name) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const std::string &material(const weaver::voxel_load_result &loaded, const char *name,
+			    size_t component, tc::voxel_face face)
+{
+	return loaded.definitions.at(name).components.at(component).faces.at(face).material;
+}
+
+void dom_and_sax_match()
+{
+	const auto dir = weaver_test::temp_dir("loader");
+	weaver_test::write_definitions(dir, 300);
+
+	weaver::sequential_executor sequential;
+	weaver::thread_pool pool;
+	const auto dom = weaver::load_voxels(dir.string(), sequential);
+	const weaver::voxel_load_options streaming{ false };
+	const auto sax = weaver::load_voxels(dir.string(), sequential, streaming);
+	const auto parallel = weaver::load_voxels(dir.string(), pool, streaming);
+
+	WEAVER_CHECK(dom.definitions.size() == 306);
+	WEAVER_CHECK(dom.json.size() == 306);
+	WEAVER_CHECK(sax.json.empty());
+	WEAVER_CHECK(equal(dom, sax));
+	WEAVER_CHECK(equal(dom, parallel));
+
+	for (auto *loaded : { &dom, &sax }) {
+		WEAVER_CHECK(material(*loaded, "oak", 0, tc::voxel_face::top) == "oak_top");
+		// the materials of a parent are applied first and win
+		WEAVER_CHECK(material(*loaded, "oak2", 1, tc::voxel_face::right) == "oak_side");
+		WEAVER_CHECK(material(*loaded, "oak2", 0, tc::voxel_face::top) == "oak_top");
+		WEAVER_CHECK(material(*loaded, "block12", 0, tc::voxel_face::bottom) == "mat12");
+		WEAVER_CHECK(material(*loaded, "noname", 1, tc::voxel_face::bottom) == "gold");
+		WEAVER_CHECK(loaded->definitions.at("noname").name == "noname");
+
+		auto &&fancy = loaded->definitions.at("fancy");
+		WEAVER_CHECK(fancy.components.at(0).faces.size() == 2);
+		WEAVER_CHECK(!fancy.components.at(0).faces.at(tc::voxel_face::top).cull);
+		WEAVER_CHECK(fancy.components.at(0).min.y == 0.25);
+		WEAVER_CHECK(fancy.components.at(0).translate.z == 2);
+
+		for (auto &&[name, def] : loaded->definitions) {
+			WEAVER_CHECK(def.type == weaver::voxel_type_id(name));
+			WEAVER_CHECK(loaded->by_index.at(def.index) == &def);
+		}
+	}
+
+	std::filesystem::remove_all(dir);
+}
+
+void cache_matches_dom()
+{
+	const auto dir = weaver_test::temp_dir("cache_sources");
+	const auto cache_dir = weaver_test::temp_dir("cache");
+	const auto cache = cache_dir / "voxels.cache";
+	weaver_test::write_definitions(dir, 300);
+
+	weaver::sequential_executor sequential;
+	const auto dom = weaver::load_voxels(dir.string(), sequential);
+
+	// the first load writes the cache, the second one reads it
+	const auto written = weaver::load_voxels_cached(dir.string(), cache, sequential);
+	WEAVER_CHECK(std::filesystem::exists(cache));
+	WEAVER_CHECK(equal(dom, written));
+
+	const auto hash = weaver::voxel_source_hash(dir.string());
+	const auto read = weaver::read_voxel_cache(cache, hash);
+	WEAVER_CHECK(read.has_value());
+	if (read) {
+		WEAVER_CHECK(equal(dom, *read));
+	}
+	WEAVER_CHECK(equal(dom, weaver::load_voxels_cached(dir.string(), cache, sequential)));
+
+	// a cache of other sources is ignored
+	WEAVER_CHECK(!weaver::read_voxel_cache(cache, hash + 1).has_value());
+
+	// so is a damaged one
+	std::filesystem::resize_file(cache, std::filesystem::file_size(cache) / 2);
+	WEAVER_CHECK(!weaver::read_voxel_cache(cache, hash).has_value());
+	WEAVER_CHECK(equal(dom, weaver::load_voxels_cached(dir.string(), cache, sequential)));
+
+	std::filesystem::remove_all(dir);
+	std::filesystem::remove_all(cache_dir);
+}
+
+void colliding_ids_throw()
+{
+	// two names whose hashes truncated to the default 32 bit voxel_id_t match
+	const std::string first{ "v15561" };
+	const std::string second{ "v1674710" };
+	WEAVER_CHECK(weaver::voxel_type_id(first) == weaver::voxel_type_id(second));
+
+	const auto dir = weaver_test::temp_dir("collision");
+	for (auto &&name : { first, second }) {
+		weaver_test::write_file(dir / (name + ".json"),
+					R"({"name": ")" + name + R"(", "components": []})");
+	}
+
+	weaver::sequential_executor sequential;
+	for (bool keep_json : { true, false }) {
+		bool thrown{ false };
+		try {
+			weaver::load_voxels(dir.string(), sequential,
+					    weaver::voxel_load_options{ keep_json });
+		} catch (const weaver::voxel_id_collision &) {
+			thrown = true;
+		}
+		WEAVER_CHECK(thrown);
+	}
+
+	std::filesystem::remove_all(dir);
+}
+void non_object_files_throw()
+{
+	for (auto &&text : { "42", "true", "\"cube\"", "null", "[1, 2]" }) {
+		const auto dir = weaver_test::temp_dir("scalar");
+		weaver_test::write_definitions(dir, 0);
+		weaver_test::write_file(dir / "scalar.json", text);
+
+		weaver::sequential_executor sequential;
+		for (bool keep_json : { true, false }) {
+			std::string error;
+			try {
+				weaver::load_voxels(dir.string(), sequential,
+						    weaver::voxel_load_options{ keep_json });
+			} catch (const std::runtime_error &e) {
+				error = e.what();
+			}
+			WEAVER_CHECK(error == "voxel definition is not a json object");
+		}
+
+		std::filesystem::remove_all(dir);
+	}
+}
+} // namespace
+
+int main()
+{
+	dom_and_sax_match();
+	cache_matches_dom();
+	colliding_ids_throw();
+	non_object_files_throw();
+	return weaver_test::result();
+}
@@ -0,0 +1,105 @@
+#include "common.hpp"
+#include "weaver/mesher.hpp"
+
+using weaver_test::voxel;
+
+namespace
+{
+tc::culling<voxel> make_culling(size_t size)
+{
+	tc::culling<voxel> culling;
+	culling.width = size;
+	culling.height = size;
+	culling.depth = size;
+	culling.add_border = true;
+	return culling;
+}
+
+void hits_and_misses()
+{
+	auto culling = make_culling(16);
+	auto a = weaver_test::random_chunk(16, 16, 16, 1);
+	auto b = weaver_test::random_chunk(16, 16, 16, 2);
+	auto c = weaver_test::random_chunk(16, 16, 16, 3);
+
+	tc::weaver::mesh_cache<> cache{ 2 };
+	auto mesh_a = cache.eval(culling, std::begin(a), std::end(a));
+	WEAVER_CHECK(cache.misses() == 1);
+	WEAVER_CHECK(cache.hits() == 0);
+	WEAVER_CHECK(weaver_test::keys(mesh_a->quads) ==
+		     weaver_test::keys(culling.eval(std::begin(a), std::end(a)).quads));
+
+	// an identical chunk shares the mesh
+	auto copy = a;
+	WEAVER_CHECK(cache.eval(culling, std::begin(copy), std::end(copy)) == mesh_a);
+	WEAVER_CHECK(cache.hits() == 1);
+
+	// a single changed voxel is another chunk
+	copy[copy.size() - 1].id = copy[copy.size() - 1].id == 1 ? 2 : 1;
+	auto mesh_copy = cache.eval(culling, std::begin(copy), std::end(copy));
+	WEAVER_CHECK(mesh_copy != mesh_a);
+	WEAVER_CHECK(cache.misses() == 2);
+	WEAVER_CHECK(cache.size() == 2);
+
+	// b evicts a, the least recently used
+	cache.eval(culling, std::begin(b), std::end(b));
+	WEAVER_CHECK(cache.size() == 2);
+	WEAVER_CHECK(cache.eval(culling, std::begin(copy), std::end(copy)) == mesh_copy);
+	WEAVER_CHECK(cache.eval(culling, std::begin(a), std::end(a)) != mesh_a);
+	WEAVER_CHECK(cache.hits() == 2);
+	WEAVER_CHECK(cache.misses() == 4);
+
+	// the reader id and the mesher's dimensions are part of the key
+	tc::weaver::voxel_reader<voxel> reader;
+	auto mesh_c = cache.eval(culling, std::begin(c), std::end(c), reader, 1);
+	WEAVER_CHECK(cache.eval(culling, std::begin(c), std::end(c), reader, 2) != mesh_c);
+	WEAVER_CHECK(cache.eval(culling, std::begin(c), std::end(c), reader, 2) != mesh_c);
+	WEAVER_CHECK(cache.hits() == 3);
+
+	auto flat = culling;
+	flat.width = 32;
+	flat.depth = 8;
+	WEAVER_CHECK(cache.eval(flat, std::begin(c), std::end(c), reader, 2) != mesh_c);
+	WEAVER_CHECK(cache.misses() == 7);
+
+	cache.clear();
+	WEAVER_CHECK(cache.size() == 0);
+}
+
+void empty_chunks_share_a_mesh()
+{
+	auto culling = make_culling(8);
+	std::vector<voxel> air(8 * 8 * 8);
+
+	tc::weaver::mesh_cache<> cache{ 4 };
+	auto mesh = cache.eval(culling, std::begin(air), std::end(air));
+	WEAVER_CHECK(mesh->quads.empty());
+	for (int i = 0; i < 10; ++i) {
+		WEAVER_CHECK(cache.eval(culling, std::begin(air), std::end(air)) == mesh);
+	}
+	WEAVER_CHECK(cache.hits() == 10);
+	WEAVER_CHECK(cache.misses() == 1);
+}
+
+void zero_capacity_never_caches()
+{
+	auto culling = make_culling(8);
+	auto a = weaver_test::random_chunk(8, 8, 8, 1);
+
+	tc::weaver::mesh_cache<> cache{ 0 };
+	auto first = cache.eval(culling, std::begin(a), std::end(a));
+	auto second = cache.eval(culling, std::begin(a), std::end(a));
+	WEAVER_CHECK(first != second);
+	WEAVER_CHECK(weaver_test::keys(first->quads) == weaver_test::keys(second->quads));
+	WEAVER_CHECK(cache.size() == 0);
+	WEAVER_CHECK(cache.hits() == 0);
+}
+} // namespace
+
+int main()
+{
+	hits_and_misses();
+	empty_chunks_share_a_mesh();
+	zero_capacity_never_caches();
+	return weaver_test::result();
+}
@@ -0,0 +1,921 @@
+#include "common.hpp"
+#include "weaver/mesher.hpp"
+#include <cmath>
+#include <set>
+
+using weaver_test::voxel;
+
+namespace
+{
+/// A voxel whose faces also depend on its state: an open voxel culls nothing,
+/// whatever its id. Its reader keeps the weaver::faces_by_type default.
+struct stateful_voxel {
+	uint8_t id{ 0 };
+	bool open{ false };
+};
+
+/// A voxel storing the dense index of its type in a voxel_table.
+struct table_voxel {
+	uint32_t index{ 0 };
+};
+} // namespace
+
+namespace tc::weaver
+{
+template <> struct voxel_reader<stateful_voxel> {
+	bool visible(const stateful_voxel &v) const
+	{
+		return v.id != 0;
+	}
+
+	voxel_id_t operator()(const stateful_voxel &v) const
+	{
+		return v.id;
+	}
+
+	std::vector<voxel_face_result> operator()(const stateful_voxel &v, voxel_face f) const
+	{
+		auto faces = voxel_reader<voxel>{}(voxel{ v.id }, f);
+		for (auto &&face : faces) {
+			face.cull = face.cull && !v.open;
+		}
+		return faces;
+	}
+};
+
+template <> struct voxel_reader<table_voxel> {
+	static constexpr bool faces_by_type = true;
+
+	bool visible(const table_voxel &v) const
+	{
+		return v.index != 0;
+	}
+
+	voxel_id_t operator()(const table_voxel &v) const
+	{
+		return static_cast<voxel_id_t>(v.index);
+	}
+
+	voxel_face_range faces(const table_voxel &v, voxel_face f) const
+	{
+		return table->faces(v.index, f);
+	}
+
+	baked_face_range baked(const table_voxel &v, voxel_face f) const
+	{
+		return table->baked(v.index, f);
+	}
+
+	uint8_t cull_mask(const table_voxel &v) const
+	{
+		return table->cull_mask(v.index);
+	}
+
+	const voxel_table *table{ nullptr };
+};
+} // namespace tc::weaver
+
+namespace
+{
+struct chunk_size {
+	int32_t width;
+	int32_t height;
+	int32_t depth;
+};
+
+/// Quads of one face of a voxel at vert, built like the meshers build them.
+template <typename Voxel>
+void add_faces(const Voxel &v, int32_t direction, const tc::vertex &vert,
+	       std::vector<tc::quad> &quads)
+{
+	tc::weaver::voxel_reader<Voxel> reader;
+
+	auto base_face = tc::cube_faces[direction];
+	base_face.normal.normalize_quick();
+	base_face.type_id = reader(v);
+
+	for (auto &&def : reader(v, static_cast<tc::voxel_face>(direction))) {
+		auto face = base_face;
+		face.material_id = def.material;
+
+		const auto uv_min = tc::weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_min);
+		const auto uv_max = tc::weaver::lerp(base_face.uv[0], base_face.uv[2], def.uv_max);
+		face.for_each([&](auto i, auto &&p, auto &&uv) {
+			p = clamp(base_face[i], tc::vertex{ def.min }, tc::vertex{ def.max });
+			p += vert + def.translate;
+			uv = tc::weaver::lerp(uv_min, uv_max, 1 - uv);
+		});
+
+		quads.emplace_back(face);
+	}
+}
+
+/// Culling the straightforward way, one voxel and face at a time: a face is
+/// kept unless the neighbour it touches is visible and culls its opposite
+/// face. at(x, y, z) returns the voxel at a position of the chunk or its
+/// border, nullptr for air.
+template <typename At> std::vector<tc::quad> reference_mesh_at(At &&at, chunk_size size)
+{
+	using voxel_t = std::remove_cv_t<std::remove_pointer_t<decltype(at(0, 0, 0))>>;
+	tc::weaver::voxel_reader<voxel_t> reader;
+
+	static constexpr auto face_count = static_cast<int32_t>(tc::voxel_face::_count);
+	std::vector<tc::quad> quads;
+	for (int32_t z = 0; z < size.depth; ++z) {
+		for (int32_t y = 0; y < size.height; ++y) {
+			for (int32_t x = 0; x < size.width; ++x) {
+				auto v = at(x, y, z);
+				if (!reader.visible(*v)) {
+					continue;
+				}
+
+				const tc::vertex vert{ static_cast<tc::weaver::decimal_t>(x),
+						       static_cast<tc::weaver::decimal_t>(y),
+						       static_cast<tc::weaver::decimal_t>(z) };
+				for (int32_t d = 0; d < face_count; ++d) {
+					auto &&offset = tc::face_offsets[d];
+					auto n = at(x + offset.x, y + offset.y, z + offset.z);
+					const auto opposite =
+						static_cast<tc::voxel_face>((d + 3) % face_count);
+
+					bool hidden{ false };
+					if (n != nullptr && reader.visible(*n)) {
+						for (auto &&def : reader(*n, opposite)) {
+							hidden = hidden || def.cull;
+						}
+					}
+
+					if (!hidden) {
+						add_faces(*v, d, vert, quads);
+					}
+				}
+			}
+		}
+	}
+
+	return quads;
+}
+
+/// reference_mesh_at of a chunk whose outside is air, like add_border.
+template <typename Voxel>
+std::vector<tc::quad> reference_mesh(const std::vector<Voxel> &voxels, chunk_size size)
+{
+	return reference_mesh_at(
+		[&](int32_t x, int32_t y, int32_t z) -> const Voxel * {
+			if (x < 0 || y < 0 || z < 0 || x >= size.width || y >= size.height ||
+			    z >= size.depth) {
+				return nullptr;
+			}
+			return &voxels[x + y * size.width + z * size.width * size.height];
+		},
+		size);
+}
+
+using cell_key = std::array<double, 8>;
+
+/// The unit voxel faces a quad covers, merged quads of greedy cover several.
+std::vector<cell_key> cells(const std::vector<tc::quad> &quads)
+{
+	std::vector<cell_key> result;
+	for (auto &&q : quads) {
+		std::array<double, 3> min{ q[0].x, q[0].y, q[0].z };
+		std::array<double, 3> max = min;
+		q.for_each([&](auto, auto &&p, auto &&) {
+			const std::array<double, 3> c{ p.x, p.y, p.z };
+			for (size_t a = 0; a < 3; ++a) {
+				min[a] = std::min(min[a], c[a]);
+				max[a] = std::max(max[a], c[a]);
+			}
+		});
+
+		std::array<int32_t, 3> first{};
+		std::array<int32_t, 3> last{};
+		for (size_t a = 0; a < 3; ++a) {
+			first[a] = static_cast<int32_t>(std::floor(min[a]));
+			last[a] = min[a] == max[a] ? first[a] + 1
+						   : static_cast<int32_t>(std::ceil(max[a]));
+		}
+
+		for (auto z = first[2]; z < last[2]; ++z) {
+			for (auto y = first[1]; y < last[1]; ++y) {
+				for (auto x = first[0]; x < last[0]; ++x) {
+					// the plane of the quad stays exact, a slab top sits at 0.5
+					result.emplace_back(cell_key{ q.normal.x, q.normal.y, q.normal.z,
+								      static_cast<double>(q.type_id),
+								      static_cast<double>(q.material_id),
+								      min[0] == max[0] ? min[0] : x,
+								      min[1] == max[1] ? min[1] : y,
+								      min[2] == max[2] ? min[2] : z });
+				}
+			}
+		}
+	}
+	std::sort(std::begin(result), std::end(result));
+	return result;
+}
+
+std::vector<voxel> random_chunk(chunk_size size, unsigned seed)
+{
+	return weaver_test::random_chunk(size.width, size.height, size.depth, seed);
+}
+
+/// random_chunk with every fourth voxel open.
+std::vector<stateful_voxel> random_stateful_chunk(chunk_size size, unsigned seed)
+{
+	std::vector<stateful_voxel> result;
+	std::mt19937 rng{ seed };
+	for (auto &&v : random_chunk(size, seed)) {
+		result.emplace_back(stateful_voxel{ v.id, rng() % 4 == 0 });
+	}
+	return result;
+}
+
+/// Mesh keys of a mesher's eval of the whole chunk.
+template <typename Mesher, typename Voxel>
+std::vector<weaver_test::quad_key> mesh(const Mesher &mesher, const std::vector<Voxel> &voxels)
+{
+	return weaver_test::keys(mesher.eval(std::begin(voxels), std::end(voxels)).quads);
+}
+
+template <typename Mesher> Mesher make_mesher(chunk_size size)
+{
+	Mesher mesher;
+	mesher.width = static_cast<size_t>(size.width);
+	mesher.height = static_cast<size_t>(size.height);
+	mesher.depth = static_cast<size_t>(size.depth);
+	mesher.add_border = true;
+	return mesher;
+}
+
+const std::vector<chunk_size> sizes{
+	{ 1, 1, 1 }, { 16, 16, 16 }, { 20, 14, 17 }, { 64, 5, 6 }, { 65, 4, 5 }, { 70, 9, 8 },
+};
+
+void culling_matches_reference()
+{
+	for (auto size : sizes) {
+		for (unsigned seed = 1; seed <= 3; ++seed) {
+			auto voxels = random_chunk(size, seed);
+			const auto expected = weaver_test::keys(reference_mesh(voxels, size));
+
+			auto culling = make_mesher<tc::culling<voxel>>(size);
+			WEAVER_CHECK(mesh(culling, voxels) == expected);
+
+			culling.count_faces = true;
+			WEAVER_CHECK(mesh(culling, voxels) == expected);
+		}
+	}
+}
+
+void binary_culling_matches_reference()
+{
+	for (auto size : sizes) {
+		for (unsigned seed = 1; seed <= 3; ++seed) {
+			auto voxels = random_chunk(size, seed);
+			const auto expected = weaver_test::keys(reference_mesh(voxels, size));
+
+			// chunks wider than 64 voxels take the tc::culling fallback
+			auto binary = make_mesher<tc::binary_culling<voxel>>(size);
+			WEAVER_CHECK(mesh(binary, voxels) == expected);
+		}
+	}
+}
+
+void per_voxel_faces_match_reference()
+{
+	// two cubes of the same type, the open one doesn't hide the other
+	const chunk_size pair{ 2, 1, 1 };
+	const std::vector<stateful_voxel> voxels{ { 1, false }, { 1, true } };
+	WEAVER_CHECK(reference_mesh(voxels, pair).size() == 11);
+	WEAVER_CHECK(mesh(make_mesher<tc::culling<stateful_voxel>>(pair), voxels) ==
+		     weaver_test::keys(reference_mesh(voxels, pair)));
+	WEAVER_CHECK(mesh(make_mesher<tc::binary_culling<stateful_voxel>>(pair), voxels) ==
+		     weaver_test::keys(reference_mesh(voxels, pair)));
+
+	for (auto size : sizes) {
+		auto chunk = random_stateful_chunk(size, 5);
+		const auto expected = weaver_test::keys(reference_mesh(chunk, size));
+		WEAVER_CHECK(mesh(make_mesher<tc::culling<stateful_voxel>>(size), chunk) == expected);
+		WEAVER_CHECK(mesh(make_mesher<tc::binary_culling<stateful_voxel>>(size), chunk) ==
+			     expected);
+	}
+}
+
+/// scan_content of a 4 * 4 * 4 chunk.
+template <typename Voxel> tc::weaver::chunk_content scan(const std::vector<Voxel> &voxels)
+{
+	const tc::weaver::volume_view<const Voxel *> view{ voxels.data(),
+							   voxels.data() + voxels.size(), 4, 4, 4 };
+	return tc::weaver::scan_content(view, tc::weaver::voxel_reader<Voxel>{});
+}
+
+void scan_content_reads_every_voxel()
+{
+	const chunk_size size{ 4, 4, 4 };
+	const auto count = static_cast<size_t>(size.width * size.height * size.depth);
+
+	std::vector<stateful_voxel> voxels(count);
+	WEAVER_CHECK(scan(voxels) == tc::weaver::chunk_content::empty);
+
+	for (auto &&v : voxels) {
+		v.id = 1;
+	}
+	WEAVER_CHECK(scan(voxels) == tc::weaver::chunk_content::solid);
+
+	// one open voxel inside shows the faces of its neighbours
+	voxels[1 + 1 * 4 + 1 * 16].open = true;
+	WEAVER_CHECK(scan(voxels) == tc::weaver::chunk_content::mixed);
+	const auto expected = weaver_test::keys(reference_mesh(voxels, size));
+	WEAVER_CHECK(expected.size() == 6 * 16 + 6);
+	WEAVER_CHECK(mesh(make_mesher<tc::culling<stateful_voxel>>(size), voxels) == expected);
+
+	// readers declaring faces_by_type are only asked about the first voxel
+	std::vector<voxel> cubes(count, voxel{ 1 });
+	WEAVER_CHECK(scan(cubes) == tc::weaver::chunk_content::solid);
+	cubes[5].id = 2;
+	WEAVER_CHECK(scan(cubes) == tc::weaver::chunk_content::mixed);
+	std::vector<voxel> glass(count, voxel{ 3 });
+	WEAVER_CHECK(scan(glass) == tc::weaver::chunk_content::mixed);
+}
+
+/// The definitions of weaver_test::voxel, index i being id i, with materials
+/// interned in index order so they get the ids of the test reader.
+std::vector<tc::voxel_def> test_definitions()
+{
+	std::vector<tc::voxel_def> defs(4);
+	for (uint32_t i = 0; i < defs.size(); ++i) {
+		auto &&def = defs[i];
+		def.name = "v" + std::to_string(i + 1);
+		def.type = tc::weaver::voxel_type_id(def.name);
+		def.index = i + 1;
+
+		tc::voxel_component_def component;
+		for (int32_t f = 0; f < static_cast<int32_t>(tc::voxel_face::_count); ++f) {
+			tc::face_def face;
+			face.material = def.name;
+			face.cull = i + 1 != 3;
+			if (i + 1 == 4) {
+				face.uv_max = tc::vector2d{ 0.5, 0.5 };
+				face.cull = static_cast<tc::voxel_face>(f) == tc::voxel_face::bottom;
+			}
+			component.faces.emplace(static_cast<tc::voxel_face>(f), face);
+		}
+		if (i + 1 == 4) {
+			component.max.z = 0.5;
+		}
+		def.components.emplace_back(component);
+	}
+	return defs;
+}
+
+void voxel_table_matches_reference()
+{
+	const auto defs = test_definitions();
+	const auto table = tc::weaver::voxel_table::compile(defs);
+	WEAVER_CHECK(table.materials().size() == 5);
+	WEAVER_CHECK(table.cull_mask(1) == 0x3f && table.cull_mask(3) == 0);
+	WEAVER_CHECK(table.cull_mask(4) == 1 << static_cast<size_t>(tc::voxel_face::bottom));
+
+	tc::weaver::voxel_reader<table_voxel> reader;
+	reader.table = &table;
+	for (auto size : sizes) {
+		auto voxels = random_chunk(size, 6);
+		std::vector<table_voxel> indices;
+		for (auto &&v : voxels) {
+			indices.emplace_back(table_voxel{ v.id });
+		}
+
+		const auto expected = weaver_test::keys(reference_mesh(voxels, size));
+		auto culling = make_mesher<tc::culling<table_voxel>>(size);
+		WEAVER_CHECK(weaver_test::keys(
+				     culling.eval(std::begin(indices), std::end(indices), reader).quads) ==
+			     expected);
+
+		auto binary = make_mesher<tc::binary_culling<table_voxel>>(size);
+		WEAVER_CHECK(weaver_test::keys(
+				     binary.eval(std::begin(indices), std::end(indices), reader).quads) ==
+			     expected);
+	}
+
+	// a dense index is given to a single definition
+	auto colliding = defs;
+	colliding[2].index = 1;
+	bool thrown{ false };
+	try {
+		tc::weaver::voxel_table::compile(colliding);
+	} catch (const tc::weaver::voxel_index_collision &e) {
+		thrown = e.index == 1 && e.first == "v1" && e.second == "v3";
+	}
+	WEAVER_CHECK(thrown);
+}
+
+void weld_quads_indexes_every_corner()
+{
+	const chunk_size size{ 20, 14, 17 };
+	auto voxels = random_chunk(size, 8);
+	auto culling = make_mesher<tc::culling<voxel>>(size);
+	auto result = culling.eval(std::begin(voxels), std::end(voxels));
+	const auto quads = result.quads;
+	tc::weaver::weld_quads(result, true);
+
+	WEAVER_CHECK(result.quads.size() == quads.size());
+	WEAVER_CHECK(result.indices.size() == quads.size() * 6);
+	WEAVER_CHECK(!result.indices.is_wide());
+	WEAVER_CHECK(result.normals.size() == result.vertices.size() &&
+		     result.uvs.size() == result.vertices.size());
+
+	// one vertex per distinct corner
+	std::set<std::array<double, 9>> corners;
+	for (auto &&q : quads) {
+		q.for_each([&](auto, auto &&p, auto &&uv) {
+			corners.insert({ p.x, p.y, p.z, q.normal.x, q.normal.y, q.normal.z, uv.x, uv.y,
+					 static_cast<double>(q.material_id) });
+		});
+	}
+	WEAVER_CHECK(result.vertices.size() == corners.size());
+
+	// the sections hold the triangles of the quads of their material, in quad order
+	size_t index_count{ 0 };
+	for (auto &&section : result.sections) {
+		WEAVER_CHECK(section.first_index == index_count);
+		auto index = section.first_index;
+		for (auto &&q : quads) {
+			if (q.material_id != section.material_id) {
+				continue;
+			}
+
+			for (auto t : { tc::quad::triangle::first, tc::quad::triangle::second }) {
+				for (auto i : q.get_triange(t)) {
+					const auto v = result.indices[index++];
+					q.for_each([&](auto c, auto &&p, auto &&uv) {
+						if (c == i) {
+							auto &&vertex = result.vertices[v];
+							auto &&normal = result.normals[v];
+							WEAVER_CHECK(vertex.x == p.x && vertex.y == p.y &&
+								     vertex.z == p.z);
+							WEAVER_CHECK(normal.x == q.normal.x &&
+								     normal.y == q.normal.y &&
+								     normal.z == q.normal.z);
+							WEAVER_CHECK(result.uvs[v].x == uv.x &&
+								     result.uvs[v].y == uv.y);
+						}
+					});
+				}
+			}
+		}
+		WEAVER_CHECK(index == section.first_index + section.index_count);
+		index_count += section.index_count;
+	}
+	WEAVER_CHECK(index_count == result.indices.size());
+
+	// indexed output is the welded quad output
+	culling.indexed = true;
+	const auto indexed = culling.eval(std::begin(voxels), std::end(voxels));
+	WEAVER_CHECK(indexed.quads.empty());
+	WEAVER_CHECK(indexed.vertices.size() == result.vertices.size());
+	WEAVER_CHECK(indexed.indices.narrow == result.indices.narrow);
+}
+
+void compact_outputs_match_quads()
+{
+	const chunk_size size{ 20, 14, 17 };
+	auto voxels = random_chunk(size, 9);
+	const auto quads =
+		make_mesher<tc::culling<voxel>>(size).eval(std::begin(voxels), std::end(voxels)).quads;
+
+	// every face is four vertices in quad corner order
+	const auto floats = make_mesher<tc::culling<voxel, tc::float_output>>(size).eval(
+		std::begin(voxels), std::end(voxels));
+	const auto shorts = make_mesher<tc::culling<voxel, tc::short_output<>>>(size).eval(
+		std::begin(voxels), std::end(voxels));
+	WEAVER_CHECK(floats.vertices.size() == quads.size() * 4 && floats.quads.empty());
+	WEAVER_CHECK(shorts.vertices.size() == quads.size() * 4 && shorts.quads.empty());
+	for (size_t f = 0; f < quads.size() && f * 4 < floats.vertices.size(); ++f) {
+		auto &&q = quads[f];
+		WEAVER_CHECK(floats.face_materials[f] == q.material_id);
+		WEAVER_CHECK(shorts.face_materials[f] == q.material_id);
+		q.for_each([&](auto i, auto &&p, auto &&uv) {
+			auto &&fv = floats.vertices[f * 4 + i];
+			WEAVER_CHECK(fv.position.x == p.x && fv.position.y == p.y && fv.position.z == p.z);
+			WEAVER_CHECK(fv.uv.x == uv.x && fv.uv.y == uv.y);
+
+			auto &&sv = shorts.vertices[f * 4 + i];
+			WEAVER_CHECK(sv.position.x == p.x * 256 && sv.position.y == p.y * 256 &&
+				     sv.position.z == p.z * 256);
+			WEAVER_CHECK(sv.uv.x == std::lround(uv.x * 65535) &&
+				     sv.uv.y == std::lround(uv.y * 65535));
+			auto normal = tc::cube_faces[fv.face].normal;
+			normal.normalize_quick();
+			WEAVER_CHECK(normal.x == q.normal.x && normal.y == q.normal.y &&
+				     normal.z == q.normal.z);
+			WEAVER_CHECK(fv.face == sv.face);
+		});
+	}
+
+	// slabs are off the integer grid and stay quads
+	const auto packed = make_mesher<tc::culling<voxel, tc::packed_output>>(size).eval(
+		std::begin(voxels), std::end(voxels));
+	std::vector<tc::quad> slabs;
+	size_t packed_faces{ 0 };
+	for (size_t f = 0; f < quads.size(); ++f) {
+		auto &&q = quads[f];
+		if (q.type_id == 4) {
+			slabs.emplace_back(q);
+			continue;
+		}
+
+		const auto first = packed_faces++ * 4;
+		if (first >= packed.vertices.size()) {
+			continue;
+		}
+		WEAVER_CHECK(packed.face_materials[packed_faces - 1] == q.material_id);
+		q.for_each([&](auto i, auto &&p, auto &&uv) {
+			auto &&v = packed.vertices[first + i];
+			WEAVER_CHECK(v.x() == p.x && v.y() == p.y && v.z() == p.z);
+			WEAVER_CHECK(v.u() == uv.x && v.v() == uv.y);
+			WEAVER_CHECK(static_cast<uint8_t>(v.face()) == floats.vertices[f * 4].face);
+		});
+	}
+	WEAVER_CHECK(packed.vertices.size() == packed_faces * 4);
+	WEAVER_CHECK(weaver_test::keys(packed.quads) == weaver_test::keys(slabs));
+}
+
+/// The quads of face records, built from the faces of the test reader.
+std::vector<tc::quad> expand(const tc::face_record_mesh &mesh)
+{
+	tc::weaver::voxel_reader<voxel> reader;
+	std::vector<tc::quad> quads;
+	for (auto &&record : mesh.records) {
+		const auto type_id = mesh.types.at(record.type_index());
+		WEAVER_CHECK(mesh.type_indices.at(type_id) == record.type_index());
+
+		const auto faces = reader(voxel{ static_cast<uint8_t>(type_id) }, record.face());
+		quads.emplace_back(tc::weaver::expand_face(record, type_id, faces.at(record.component())));
+	}
+	return quads;
+}
+
+void face_records_expand_to_quads()
+{
+	for (auto size : { chunk_size{ 20, 14, 17 }, chunk_size{ 70, 9, 8 } }) {
+		auto voxels = random_chunk(size, 10);
+		const auto expected = weaver_test::keys(reference_mesh(voxels, size));
+
+		auto culling = make_mesher<tc::culling<voxel, tc::face_record_output>>(size);
+		const auto records = culling.eval(std::begin(voxels), std::end(voxels));
+		WEAVER_CHECK(records.records.size() == expected.size());
+		WEAVER_CHECK(records.types.size() == records.type_indices.size());
+
+		WEAVER_CHECK(weaver_test::keys(expand(records)) == expected);
+
+		// slabs meshed on a pool are appended with their type indices remapped
+		tc::weaver::thread_pool pool{ 4 };
+		culling.pool = &pool;
+		culling.slab_depth = 3;
+		const auto appended = culling.eval(std::begin(voxels), std::end(voxels));
+		WEAVER_CHECK(appended.records.size() == expected.size());
+		WEAVER_CHECK(weaver_test::keys(expand(appended)) == expected);
+	}
+}
+
+void padded_input_culls_against_its_border()
+{
+	for (auto size : sizes) {
+		// a random chunk including its border, which is read but not meshed
+		const chunk_size padded_size{ size.width + 2, size.height + 2, size.depth + 2 };
+		auto padded = random_chunk(padded_size, 11);
+		auto at = [&](int32_t x, int32_t y, int32_t z) -> const voxel * {
+			return &padded[(x + 1) + (y + 1) * padded_size.width +
+				       (z + 1) * padded_size.width * padded_size.height];
+		};
+		const auto expected = weaver_test::keys(reference_mesh_at(at, size));
+
+		auto culling = make_mesher<tc::culling<voxel>>(size);
+		culling.add_border = false;
+		WEAVER_CHECK(mesh(culling, padded) == expected);
+
+		auto binary = make_mesher<tc::binary_culling<voxel>>(size);
+		binary.add_border = false;
+		WEAVER_CHECK(mesh(binary, padded) == expected);
+
+		auto greedy = make_mesher<tc::greedy<voxel>>(size);
+		greedy.add_border = false;
+		WEAVER_CHECK(cells(greedy.eval(std::begin(padded), std::end(padded)).quads) ==
+			     cells(reference_mesh_at(at, size)));
+	}
+}
+
+void neighbors_cull_the_boundary()
+{
+	for (auto size : { chunk_size{ 16, 16, 16 }, chunk_size{ 20, 14, 17 },
+			   chunk_size{ 70, 9, 8 } }) {
+		auto center = random_chunk(size, 12);
+		std::array<std::vector<voxel>, 6> chunks;
+		for (size_t f = 0; f < chunks.size(); ++f) {
+			chunks[f] = random_chunk(size, 13 + static_cast<unsigned>(f));
+		}
+
+		// the top neighbour isn't loaded and stays air
+		using iter = std::vector<voxel>::const_iterator;
+		tc::weaver::chunk_neighbors<iter> neighbors;
+		for (size_t f = 0; f < chunks.size(); ++f) {
+			if (static_cast<tc::voxel_face>(f) != tc::voxel_face::top) {
+				neighbors.set(static_cast<tc::voxel_face>(f), chunks[f].cbegin());
+			}
+		}
+
+		auto at = [&](int32_t x, int32_t y, int32_t z) -> const voxel * {
+			auto &&offsets = tc::face_offsets;
+			for (size_t f = 0; f < chunks.size(); ++f) {
+				const auto nx = x - offsets[f].x * size.width;
+				const auto ny = y - offsets[f].y * size.height;
+				const auto nz = z - offsets[f].z * size.depth;
+				const bool inside = nx >= 0 && ny >= 0 && nz >= 0 && nx < size.width &&
+						    ny < size.height && nz < size.depth;
+				if (inside && static_cast<tc::voxel_face>(f) != tc::voxel_face::top) {
+					return &chunks[f][nx + ny * size.width + nz * size.width * size.height];
+				}
+			}
+
+			const bool inside = x >= 0 && y >= 0 && z >= 0 && x < size.width &&
+					    y < size.height && z < size.depth;
+			return inside ? &center[x + y * size.width + z * size.width * size.height]
+				      : nullptr;
+		};
+		const auto expected = weaver_test::keys(reference_mesh_at(at, size));
+		WEAVER_CHECK(expected != weaver_test::keys(reference_mesh(center, size)));
+		const auto planes = static_cast<tc::weaver::face_mask>(
+			0x3f & ~(1 << static_cast<size_t>(tc::voxel_face::top)));
+
+		const auto culled = make_mesher<tc::culling<voxel>>(size).eval(
+			center.cbegin(), center.cend(), neighbors);
+		WEAVER_CHECK(culled.planes == planes);
+		WEAVER_CHECK(weaver_test::keys(culled.mesh.quads) == expected);
+
+		const auto binary = make_mesher<tc::binary_culling<voxel>>(size).eval(
+			center.cbegin(), center.cend(), neighbors);
+		WEAVER_CHECK(binary.planes == planes);
+		WEAVER_CHECK(weaver_test::keys(binary.mesh.quads) == expected);
+
+		const auto greedy = make_mesher<tc::greedy<voxel>>(size).eval(
+			center.cbegin(), center.cend(), neighbors);
+		WEAVER_CHECK(greedy.planes == planes);
+		WEAVER_CHECK(cells(greedy.mesh.quads) == cells(reference_mesh_at(at, size)));
+	}
+}
+
+/// Keys of the quads in the order they were emitted.
+std::vector<weaver_test::quad_key> ordered_keys(const std::vector<tc::quad> &quads)
+{
+	std::vector<weaver_test::quad_key> result;
+	for (auto &&q : quads) {
+		result.emplace_back(weaver_test::key(q));
+	}
+	return result;
+}
+
+template <typename Mesher> void check_batch(const Mesher &mesher)
+{
+	const chunk_size size{ static_cast<int32_t>(mesher.width),
+			       static_cast<int32_t>(mesher.height),
+			       static_cast<int32_t>(mesher.depth) };
+	std::vector<std::vector<voxel>> chunks;
+	for (unsigned seed = 0; seed < 24; ++seed) {
+		chunks.emplace_back(random_chunk(size, 20 + seed));
+	}
+	// an empty and a solid chunk between the others
+	chunks[5].assign(chunks[5].size(), voxel{});
+	chunks[6].assign(chunks[6].size(), voxel{ 2 });
+
+	tc::weaver::sequential_executor sequential;
+	tc::weaver::thread_pool pool{ 4 };
+	const auto serial = tc::weaver::mesh_batch(mesher, chunks, sequential);
+	const auto parallel = tc::weaver::mesh_batch(mesher, chunks, pool);
+	WEAVER_CHECK(serial.size() == chunks.size() && parallel.size() == chunks.size());
+	for (size_t i = 0; i < chunks.size() && i < serial.size() && i < parallel.size(); ++i) {
+		const auto expected =
+			ordered_keys(mesher.eval(std::begin(chunks[i]), std::end(chunks[i])).quads);
+		WEAVER_CHECK(ordered_keys(serial[i].quads) == expected);
+		WEAVER_CHECK(ordered_keys(parallel[i].quads) == expected);
+	}
+}
+
+void mesh_batch_matches_eval()
+{
+	const chunk_size size{ 20, 14, 17 };
+	check_batch(make_mesher<tc::culling<voxel>>(size));
+	check_batch(make_mesher<tc::binary_culling<voxel>>(size));
+	check_batch(make_mesher<tc::greedy<voxel>>(size));
+	check_batch(make_mesher<tc::simple<voxel>>(size));
+}
+
+void slabs_match_serial()
+{
+	tc::weaver::thread_pool pool{ 4 };
+	for (auto size : sizes) {
+		auto voxels = random_chunk(size, 30);
+		auto culling = make_mesher<tc::culling<voxel>>(size);
+		const auto serial = culling.eval(std::begin(voxels), std::end(voxels));
+
+		// the same quads in the same order, whatever the slab depth
+		culling.pool = &pool;
+		for (size_t slab_depth : { 1, 3, 16 }) {
+			culling.slab_depth = slab_depth;
+			culling.count_faces = slab_depth == 3;
+			const auto slabs = culling.eval(std::begin(voxels), std::end(voxels));
+			WEAVER_CHECK(ordered_keys(slabs.quads) == ordered_keys(serial.quads));
+		}
+
+		culling.indexed = true;
+		const auto indexed = culling.eval(std::begin(voxels), std::end(voxels));
+		culling.pool = nullptr;
+		const auto indexed_serial = culling.eval(std::begin(voxels), std::end(voxels));
+		WEAVER_CHECK(indexed.vertices.size() == indexed_serial.vertices.size());
+		WEAVER_CHECK(indexed.indices.narrow == indexed_serial.indices.narrow);
+		WEAVER_CHECK(indexed.indices.wide == indexed_serial.indices.wide);
+	}
+}
+
+void face_kernels_match_scalar()
+{
+	namespace internal = tc::weaver::internal;
+	std::vector<internal::face_row_kernel> kernels{ internal::face_row() };
+#if WEAVER_SIMD_X86
+	if (internal::has_sse2()) {
+		kernels.emplace_back(&internal::face_row_sse2);
+	}
+	if (internal::has_avx2()) {
+		kernels.emplace_back(&internal::face_row_avx2);
+	}
+#endif
+
+	// random visible and cull bits, row lengths around the vector widths
+	std::mt19937 rng{ 40 };
+	auto row = [&rng](size_t count) {
+		std::vector<uint8_t> bytes(count);
+		for (auto &&b : bytes) {
+			b = static_cast<uint8_t>(rng() & 0x7f);
+		}
+		return bytes;
+	};
+	for (size_t count = 0; count <= 100; ++count) {
+		auto center = row(count + 2);
+		auto back = row(count);
+		auto front = row(count);
+		auto top = row(count);
+		auto bottom = row(count);
+
+		std::vector<uint8_t> expected(count);
+		internal::face_row_scalar(center.data() + 1, back.data(), front.data(), top.data(),
+					  bottom.data(), expected.data(), count);
+		for (auto kernel : kernels) {
+			std::vector<uint8_t> out(count);
+			kernel(center.data() + 1, back.data(), front.data(), top.data(), bottom.data(),
+			       out.data(), count);
+			WEAVER_CHECK(out == expected);
+		}
+	}
+}
+
+void fixed_meshers_match_dynamic()
+{
+	const chunk_size size{ 20, 14, 17 };
+	const chunk_size padded_size{ 22, 16, 19 };
+	auto voxels = random_chunk(size, 50);
+	auto padded = random_chunk(padded_size, 51);
+
+	tc::fixed_culling<voxel, 20, 14, 17> fixed_culling;
+	tc::fixed_simple<voxel, 20, 14, 17> fixed_simple;
+	auto culling = make_mesher<tc::culling<voxel>>(size);
+	auto simple = make_mesher<tc::simple<voxel>>(size);
+	for (bool add_border : { true, false }) {
+		auto &&chunk = add_border ? voxels : padded;
+		fixed_culling.add_border = add_border;
+		fixed_simple.add_border = add_border;
+		culling.add_border = add_border;
+		simple.add_border = add_border;
+
+		WEAVER_CHECK(
+			ordered_keys(fixed_culling.eval(std::begin(chunk), std::end(chunk)).quads) ==
+			ordered_keys(culling.eval(std::begin(chunk), std::end(chunk)).quads));
+		WEAVER_CHECK(
+			ordered_keys(fixed_simple.eval(std::begin(chunk), std::end(chunk)).quads) ==
+			ordered_keys(simple.eval(std::begin(chunk), std::end(chunk)).quads));
+	}
+	fixed_culling.add_border = true;
+	WEAVER_CHECK(mesh(fixed_culling, voxels) == weaver_test::keys(reference_mesh(voxels, size)));
+
+	// simple doesn't cull, every visible voxel has its six faces
+	fixed_simple.add_border = true;
+	WEAVER_CHECK(fixed_simple.eval(std::begin(voxels), std::end(voxels)).quads.size() ==
+		     6 * static_cast<size_t>(std::count_if(std::begin(voxels), std::end(voxels),
+							   [](auto &&v) { return v.id != 0; })));
+}
+
+void greedy_covers_reference()
+{
+	for (auto size : sizes) {
+		for (unsigned seed = 1; seed <= 3; ++seed) {
+			auto voxels = random_chunk(size, seed);
+			const auto reference = reference_mesh(voxels, size);
+
+			auto greedy = make_mesher<tc::greedy<voxel>>(size);
+			const auto quads = greedy.eval(std::begin(voxels), std::end(voxels)).quads;
+			WEAVER_CHECK(cells(quads) == cells(reference));
+			WEAVER_CHECK(quads.size() <= reference.size());
+
+			// slabs use part of their texture and are never merged
+			std::vector<tc::quad> slabs;
+			for (auto &&q : reference) {
+				if (q.type_id == 4) {
+					slabs.emplace_back(q);
+				}
+			}
+			std::vector<tc::quad> greedy_slabs;
+			for (auto &&q : quads) {
+				if (q.type_id == 4) {
+					greedy_slabs.emplace_back(q);
+				}
+			}
+			WEAVER_CHECK(weaver_test::keys(greedy_slabs) == weaver_test::keys(slabs));
+		}
+	}
+}
+
+void greedy_merges_a_solid_chunk()
+{
+	const chunk_size size{ 70, 8, 4 };
+	std::vector<voxel> voxels(static_cast<size_t>(size.width * size.height * size.depth),
+				  voxel{ 1 });
+
+	auto greedy = make_mesher<tc::greedy<voxel>>(size);
+	const auto quads = greedy.eval(std::begin(voxels), std::end(voxels)).quads;
+	WEAVER_CHECK(quads.size() == 6);
+	WEAVER_CHECK(cells(quads) == cells(reference_mesh(voxels, size)));
+
+	// the uvs repeat once per voxel
+	for (auto &&q : quads) {
+		double uv_max{ 0 };
+		q.for_each([&](auto, auto &&, auto &&uv) {
+			uv_max = std::max({ uv_max, uv.x, uv.y });
+		});
+		WEAVER_CHECK(uv_max == size.width || uv_max == size.height ||
+			     uv_max == size.depth);
+	}
+}
+
+void incremental_matches_reference()
+{
+	for (auto size : { chunk_size{ 20, 14, 17 }, chunk_size{ 70, 6, 5 } }) {
+		auto voxels = random_chunk(size, 4);
+
+		// incremental always treats the outside of the chunk as air
+		tc::incremental<voxel> incremental;
+		incremental.width = static_cast<size_t>(size.width);
+		incremental.height = static_cast<size_t>(size.height);
+		incremental.depth = static_cast<size_t>(size.depth);
+		incremental.eval(voxels.data());
+		WEAVER_CHECK(weaver_test::keys(incremental.result().quads) ==
+			     weaver_test::keys(reference_mesh(voxels, size)));
+
+		std::mt19937 rng{ 7 };
+		for (int32_t frame = 0; frame < 25; ++frame) {
+			const auto edits = 1 + rng() % 20;
+			for (uint32_t e = 0; e < edits; ++e) {
+				const tc::vector3i p{ static_cast<int32_t>(rng() % size.width),
+						      static_cast<int32_t>(rng() % size.height),
+						      static_cast<int32_t>(rng() % size.depth) };
+				voxels[p.x + p.y * size.width + p.z * size.width * size.height].id =
+					static_cast<uint8_t>(rng() % 5);
+				incremental.mark(p);
+			}
+
+			incremental.update();
+			WEAVER_CHECK(weaver_test::keys(incremental.result().quads) ==
+				     weaver_test::keys(reference_mesh(voxels, size)));
+		}
+	}
+}
+} // namespace
+
+int main()
+{
+	culling_matches_reference();
+	binary_culling_matches_reference();
+	per_voxel_faces_match_reference();
+	scan_content_reads_every_voxel();
+	voxel_table_matches_reference();
+	weld_quads_indexes_every_corner();
+	compact_outputs_match_quads();
+	face_records_expand_to_quads();
+	padded_input_culls_against_its_border();
+	neighbors_cull_the_boundary();
+	mesh_batch_matches_eval();
+	slabs_match_serial();
+	face_kernels_match_scalar();
+	fixed_meshers_match_dynamic();
+	greedy_covers_reference();
+	greedy_merges_a_solid_chunk();
+	incremental_matches_reference();
+	return weaver_test::result();
+}
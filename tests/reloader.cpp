@@ -0,0 +1,212 @@
+#include "common.hpp"
+#include "weaver/core/voxel_reloader.hpp"
+#include "weaver/mesher/voxel_table.hpp"
+#include <algorithm>
+
+namespace weaver = tc::weaver;
+
+namespace
+{
+const std::string &top_material(const weaver::voxel_snapshot &snapshot, const char *name)
+{
+	auto &&def = snapshot.entries.at(name)->def;
+	return def.components.at(0).faces.at(tc::voxel_face::top).material;
+}
+
+bool contains(const std::vector<weaver::voxel_id_t> &ids, const char *name)
+{
+	const auto type = weaver::voxel_type_id(name);
+	return std::find(std::begin(ids), std::end(ids), type) != std::end(ids);
+}
+
+std::string block(const std::string &name, const std::string &parent, const std::string &material)
+{
+	return R"({"name": ")" + name + R"(", "$parent": ")" + parent +
+	       R"(", "materials": {"all": ")" + material + R"("}})";
+}
+
+void loads_the_directory()
+{
+	const auto dir = weaver_test::temp_dir("reload");
+	weaver_test::write_definitions(dir, 20);
+
+	weaver::sequential_executor sequential;
+	weaver::voxel_reloader reloader{ dir.string(), sequential };
+	const auto loaded = weaver::load_voxels(dir.string(), sequential);
+
+	auto snapshot = reloader.snapshot();
+	WEAVER_CHECK(snapshot->entries.size() == loaded.definitions.size());
+	for (auto &&[name, def] : loaded.definitions) {
+		auto found = snapshot->find(name);
+		WEAVER_CHECK(found != nullptr && found->type == def.type &&
+			     found->components.size() == def.components.size());
+		WEAVER_CHECK(snapshot->find(def.type) == found);
+	}
+	WEAVER_CHECK(reloader.poll().empty());
+	WEAVER_CHECK(reloader.snapshot() == snapshot);
+
+	std::filesystem::remove_all(dir);
+}
+
+void keeps_the_last_good_definition_of_an_invalid_file()
+{
+	const auto dir = weaver_test::temp_dir("reload_invalid");
+	weaver_test::write_definitions(dir, 20);
+
+	weaver::sequential_executor sequential;
+	weaver::voxel_reloader reloader{ dir.string(), sequential };
+	const auto before = reloader.snapshot();
+
+	// a file caught half written next to a good edit
+	weaver_test::write_file(dir / "block3.json", R"({"name": "block3", "$parent":)");
+	weaver_test::write_file(dir / "block4.json", block("block4", "cube", "brand_new"));
+
+	auto changed = reloader.poll();
+	auto after = reloader.snapshot();
+	WEAVER_CHECK(changed.size() == 1 && contains(changed, "block4"));
+	WEAVER_CHECK(top_material(*after, "block4") == "brand_new");
+	WEAVER_CHECK(top_material(*after, "block3") == "mat3");
+	WEAVER_CHECK(reloader.errors().size() == 1);
+	WEAVER_CHECK(!reloader.errors().empty() && reloader.errors()[0].file == "block3.json");
+
+	// untouched definitions are shared with the previous snapshot
+	WEAVER_CHECK(after->entries.at("oak") == before->entries.at("oak"));
+	WEAVER_CHECK(after->entries.at("block3") == before->entries.at("block3"));
+	WEAVER_CHECK(after->entries.at("block4") != before->entries.at("block4"));
+	WEAVER_CHECK(top_material(*before, "block4") == "mat4");
+
+	// the broken file is retried until it loads
+	WEAVER_CHECK(reloader.poll().empty());
+	WEAVER_CHECK(reloader.errors().size() == 1);
+
+	weaver_test::write_file(dir / "block3.json", block("block3", "cube", "fixed"));
+	changed = reloader.poll();
+	WEAVER_CHECK(changed.size() == 1 && contains(changed, "block3"));
+	WEAVER_CHECK(reloader.errors().empty());
+	WEAVER_CHECK(top_material(*reloader.snapshot(), "block3") == "fixed");
+
+	std::filesystem::remove_all(dir);
+}
+
+void keeps_the_snapshot_when_resolving_fails()
+{
+	const auto dir = weaver_test::temp_dir("reload_parent");
+	weaver_test::write_definitions(dir, 20);
+
+	weaver::sequential_executor sequential;
+	weaver::voxel_reloader reloader{ dir.string(), sequential };
+	const auto before = reloader.snapshot();
+
+	weaver_test::write_file(dir / "block5.json", block("block5", "missing", "moved"));
+	weaver_test::write_file(dir / "block6.json", block("block6", "cube", "other"));
+	bool thrown{ false };
+	try {
+		reloader.poll();
+	} catch (const std::exception &) {
+		thrown = true;
+	}
+	WEAVER_CHECK(thrown);
+	WEAVER_CHECK(reloader.snapshot() == before);
+
+	// both files are queued and load once the parent exists
+	weaver_test::write_file(dir / "missing.json", R"({"name": "missing", "$parent": "cube"})");
+	const auto changed = reloader.poll();
+	WEAVER_CHECK(contains(changed, "block5") && contains(changed, "block6") &&
+		     contains(changed, "missing"));
+	WEAVER_CHECK(top_material(*reloader.snapshot(), "block5") == "moved");
+	WEAVER_CHECK(top_material(*reloader.snapshot(), "block6") == "other");
+
+	std::filesystem::remove_all(dir);
+}
+
+void reloading_other_files_keeps_the_queue()
+{
+	const auto dir = weaver_test::temp_dir("reload_subset");
+	weaver_test::write_definitions(dir, 20);
+
+	weaver::sequential_executor sequential;
+	weaver::voxel_reloader reloader{ dir.string(), sequential };
+
+	weaver_test::write_file(dir / "block3.json", R"({"name": "block3", "$parent":)");
+	reloader.poll();
+	WEAVER_CHECK(reloader.errors().size() == 1);
+
+	// a reload of other files leaves the broken one queued
+	weaver_test::write_file(dir / "block4.json", block("block4", "cube", "brand_new"));
+	auto changed = reloader.reload({ "block4.json" }, sequential);
+	WEAVER_CHECK(changed.size() == 1 && contains(changed, "block4"));
+	WEAVER_CHECK(reloader.errors().size() == 1);
+	WEAVER_CHECK(!reloader.errors().empty() && reloader.errors()[0].file == "block3.json");
+
+	weaver_test::write_file(dir / "block3.json", block("block3", "cube", "fixed"));
+	changed = reloader.poll();
+	WEAVER_CHECK(changed.size() == 1 && contains(changed, "block3"));
+	WEAVER_CHECK(reloader.errors().empty());
+	WEAVER_CHECK(top_material(*reloader.snapshot(), "block3") == "fixed");
+
+	std::filesystem::remove_all(dir);
+}
+
+void follows_parents_and_keeps_indices()
+{
+	const auto dir = weaver_test::temp_dir("reload_parents");
+	weaver_test::write_definitions(dir, 20);
+
+	weaver::sequential_executor sequential;
+	weaver::voxel_reloader reloader{ dir.string(), sequential };
+	const auto before = reloader.snapshot();
+
+	// every block inherits the cube
+	weaver_test::write_file(
+		dir / "cube.json",
+		R"({"name": "cube", "components": [{"face": {"top": {"material": "${all}"}}}]})");
+	auto changed = reloader.poll();
+	WEAVER_CHECK(changed.size() == 21);
+	WEAVER_CHECK(contains(changed, "block0") && !contains(changed, "oak"));
+	WEAVER_CHECK(reloader.snapshot()->find("block7")->components.at(0).faces.size() == 1);
+	WEAVER_CHECK(before->find("block7")->components.at(0).faces.size() == 6);
+
+	// removed names keep their index, new ones are added after them
+	const auto index = before->find("block2")->index;
+	std::filesystem::remove(dir / "block2.json");
+	changed = reloader.poll();
+	WEAVER_CHECK(changed.size() == 1 && contains(changed, "block2"));
+
+	auto snapshot = reloader.snapshot();
+	WEAVER_CHECK(snapshot->find("block2") == nullptr);
+	WEAVER_CHECK(snapshot->by_index.size() == before->by_index.size());
+	WEAVER_CHECK(snapshot->by_index.at(index) == nullptr);
+
+	weaver_test::write_file(dir / "zz.json", block("block2", "cube", "back"));
+	reloader.poll();
+	snapshot = reloader.snapshot();
+	WEAVER_CHECK(snapshot->find("block2") != nullptr &&
+		     snapshot->find("block2")->index == index);
+
+	weaver_test::write_file(dir / "new.json", block("new", "cube", "new"));
+	reloader.poll();
+	snapshot = reloader.snapshot();
+	WEAVER_CHECK(snapshot->find("new") != nullptr &&
+		     snapshot->find("new")->index == before->by_index.size());
+
+	// tables compile from the snapshot, skipping removed definitions
+	std::filesystem::remove(dir / "new.json");
+	reloader.poll();
+	snapshot = reloader.snapshot();
+	const auto table = weaver::voxel_table::compile(snapshot->by_index);
+	WEAVER_CHECK(table.index(weaver::voxel_type_id("block2")) == index);
+	WEAVER_CHECK(table.index(weaver::voxel_type_id("new")) == weaver::voxel_table::npos);
+
+	std::filesystem::remove_all(dir);
+}
+} // namespace
+
+int main()
+{
+	loads_the_directory();
+	keeps_the_last_good_definition_of_an_invalid_file();
+	keeps_the_snapshot_when_resolving_fails();
+	reloading_other_files_keeps_the_queue();
+	follows_parents_and_keeps_indices();
+	return weaver_test::result();
+}